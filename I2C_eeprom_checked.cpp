@@ -0,0 +1,371 @@
+//
+//    FILE: I2C_eeprom_checked.cpp
+// PURPOSE: self checking page format (CRC-16 or SECDED) for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_checked.h"
+
+
+uint16_t I2C_eeprom_crc16(const uint8_t * data, const uint16_t length, uint16_t crc)
+{
+  for (uint16_t i = 0; i < length; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t b = 0; b < 8; b++)
+    {
+      crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+
+I2C_eeprom_checked::I2C_eeprom_checked(I2C_eeprom & eeprom, const uint16_t firstPage, const uint16_t pages, const uint8_t mode) :
+                    _eeprom(eeprom), _firstPage(firstPage), _pages(pages), _mode(mode)
+{
+  _pageSize = _eeprom.getPageSize();
+  if (_pageSize > I2C_EEPROM_CHECKED_MAXPAGE) _pageSize = I2C_EEPROM_CHECKED_MAXPAGE;
+}
+
+
+uint16_t I2C_eeprom_checked::size()
+{
+  return _pages * payload();
+}
+
+
+uint16_t I2C_eeprom_checked::pages()
+{
+  return _pages;
+}
+
+
+uint8_t I2C_eeprom_checked::payload()
+{
+  return _pageSize - 2;
+}
+
+
+uint8_t I2C_eeprom_checked::getMode()
+{
+  return _mode;
+}
+
+
+I2C_eeprom & I2C_eeprom_checked::getEEPROM()
+{
+  return _eeprom;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  LOGICAL ACCESS
+//
+
+//  returns bytes read
+uint16_t I2C_eeprom_checked::read(const uint16_t address, uint8_t * buffer, const uint16_t length)
+{
+  uint16_t addr = address;
+  uint16_t len = length;
+  if ((uint32_t)addr + len > size()) return 0;
+  uint16_t rv = 0;
+  while (len > 0)
+  {
+    uint16_t page = addr / payload();
+    uint8_t offset = addr % payload();
+    uint16_t cnt = payload() - offset;
+    if (cnt > len) cnt = len;
+
+    uint8_t status = _loadPage(page);
+    if (status >= I2C_EEPROM_PAGE_CORRUPT) return rv;
+    memcpy(buffer, _page + offset, cnt);
+
+    rv     += cnt;
+    addr   += cnt;
+    buffer += cnt;
+    len    -= cnt;
+  }
+  return rv;
+}
+
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom_checked::write(const uint16_t address, const uint8_t * buffer, const uint16_t length)
+{
+  uint16_t addr = address;
+  uint16_t len = length;
+  if ((uint32_t)addr + len > size()) return 12;  //  see _pageBlock()
+  while (len > 0)
+  {
+    uint16_t page = addr / payload();
+    uint8_t offset = addr % payload();
+    uint16_t cnt = payload() - offset;
+    if (cnt > len) cnt = len;
+
+    //  only a partial page needs the old payload, a bad one is not
+    //  rewritten with a fresh check word.
+    if (cnt < payload())
+    {
+      uint8_t status = _loadPage(page);
+      if (status == I2C_EEPROM_PAGE_READ_ERROR) return 14;
+      if (status == I2C_EEPROM_PAGE_CORRUPT) return I2C_EEPROM_CHECKED_CORRUPT;
+    }
+    memcpy(_page + offset, buffer, cnt);
+    int rv = _storePage(page);
+    if (rv != 0) return rv;
+
+    addr   += cnt;
+    buffer += cnt;
+    len    -= cnt;
+  }
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PAGE ACCESS
+//
+uint8_t I2C_eeprom_checked::readPage(const uint16_t page, uint8_t * payload)
+{
+  if (page >= _pages) return I2C_EEPROM_PAGE_READ_ERROR;
+  uint8_t status = _loadPage(page);
+  memcpy(payload, _page, this->payload());
+  return status;
+}
+
+
+int I2C_eeprom_checked::writePage(const uint16_t page, const uint8_t * payload)
+{
+  if (page >= _pages) return 12;
+  memcpy(_page, payload, this->payload());
+  return _storePage(page);
+}
+
+
+uint8_t I2C_eeprom_checked::checkPage(const uint16_t page, const bool repair)
+{
+  if (page >= _pages) return I2C_EEPROM_PAGE_READ_ERROR;
+  uint8_t status = _loadPage(page, true);
+  if ((status == I2C_EEPROM_PAGE_CORRECTED) && repair) _storePage(page, false);
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  VERIFY POLICY
+//
+void I2C_eeprom_checked::setVerifyPolicy(const uint8_t policy, const uint8_t sampleRate)
+{
+  _policy = policy;
+  _sampleRate = (sampleRate == 0) ? 1 : sampleRate;
+  _sampleCount = 0;
+  _deferredCount = 0;
+}
+
+
+uint8_t I2C_eeprom_checked::getVerifyPolicy()
+{
+  return _policy;
+}
+
+
+//  returns pages that failed.
+uint8_t I2C_eeprom_checked::verifyPending()
+{
+  uint8_t failed = 0;
+  for (uint8_t i = 0; i < _deferredCount; i++)
+  {
+    if (! _verifyPage(_deferred[i], _deferredCheck[i]))
+    {
+      failed++;
+      _verifyFailures++;
+    }
+  }
+  _deferredCount = 0;
+  return failed;
+}
+
+
+uint32_t I2C_eeprom_checked::getCorrected()
+{
+  return _corrected;
+}
+
+
+uint32_t I2C_eeprom_checked::getCorrupt()
+{
+  return _corrupt;
+}
+
+
+uint32_t I2C_eeprom_checked::getVerifyFailures()
+{
+  return _verifyFailures;
+}
+
+
+uint8_t I2C_eeprom_checked::getLastStatus()
+{
+  return _lastStatus;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PRIVATE
+//
+
+//  SECDED: data bit i gets the i-th number >= 3 that is not a power of 2
+//  as code, the check word holds the XOR of the codes of all set bits
+//  (bits 0..10) and the overall parity of data and check bits (bit 15).
+//  a single flipped data bit gives its own code as syndrome, a flipped
+//  check bit gives a power of 2.
+uint16_t I2C_eeprom_checked::_check(const uint8_t * data, const uint8_t length)
+{
+  if (_mode == I2C_EEPROM_CHECK_CRC16) return I2C_eeprom_crc16(data, length);
+
+  uint16_t syndrome = 0;
+  uint8_t parity = 0;
+  uint16_t code = 2;
+  for (uint16_t i = 0; i < length * 8; i++)
+  {
+    code++;
+    if ((code & (code - 1)) == 0) code++;
+    if (data[i / 8] & (1 << (i % 8)))
+    {
+      syndrome ^= code;
+      parity ^= 1;
+    }
+  }
+  for (uint16_t s = syndrome; s; s >>= 1) parity ^= (s & 1);
+  return syndrome | ((uint16_t)parity << 15);
+}
+
+
+//  validates data[length] against the check word in the next two bytes,
+//  corrects it in place if possible. returns page status.
+uint8_t I2C_eeprom_checked::_decode(uint8_t * data, const uint8_t length)
+{
+  uint16_t stored = data[length] | (data[length + 1] << 8);
+  uint16_t computed = _check(data, length);
+  if (stored == computed) return I2C_EEPROM_PAGE_OK;
+
+  //  erased page
+  bool blank = true;
+  for (uint8_t i = 0; blank && (i < length + 2); i++) blank = (data[i] == 0xFF);
+  if (blank) return I2C_EEPROM_PAGE_OK;
+
+  if (_mode == I2C_EEPROM_CHECK_CRC16) return I2C_EEPROM_PAGE_CORRUPT;
+
+  uint16_t syndrome = (stored ^ computed) & 0x7FFF;
+  uint8_t parity = (stored ^ computed) >> 15;
+  //  the parity of the check bits is part of the overall parity.
+  for (uint16_t s = syndrome; s; s >>= 1) parity ^= (s & 1);
+  //  even number of flipped bits, but not zero.
+  if (parity == 0) return I2C_EEPROM_PAGE_CORRUPT;
+
+  //  single error in the parity or a check bit, data is fine.
+  if ((syndrome & (syndrome - 1)) == 0) return I2C_EEPROM_PAGE_CORRECTED;
+
+  uint16_t code = 2;
+  for (uint16_t i = 0; i < length * 8; i++)
+  {
+    code++;
+    if ((code & (code - 1)) == 0) code++;
+    if (code == syndrome)
+    {
+      data[i / 8] ^= (1 << (i % 8));
+      return I2C_EEPROM_PAGE_CORRECTED;
+    }
+  }
+  return I2C_EEPROM_PAGE_CORRUPT;
+}
+
+
+//  reads a physical page into _page, returns page status.
+//  uncached reads the device, not the read shadow, for verification.
+uint8_t I2C_eeprom_checked::_loadPage(const uint16_t page, const bool uncached)
+{
+  uint16_t address = (_firstPage + page) * _pageSize;
+  uint16_t length = uncached ? _eeprom.readBlockUncached(address, _page, _pageSize)
+                             : _eeprom.readBlock(address, _page, _pageSize);
+  if (length != _pageSize)
+  {
+    _lastStatus = I2C_EEPROM_PAGE_READ_ERROR;
+    return _lastStatus;
+  }
+  _lastStatus = _decode(_page, payload());
+  if (_lastStatus == I2C_EEPROM_PAGE_CORRECTED) _corrected++;
+  if (_lastStatus == I2C_EEPROM_PAGE_CORRUPT)   _corrupt++;
+  return _lastStatus;
+}
+
+
+//  writes the payload in _page with a new check word.
+//  returns I2C status, 0 = OK
+int I2C_eeprom_checked::_storePage(const uint16_t page, const bool verify)
+{
+  uint16_t check = _check(_page, payload());
+  _page[payload()]     = check & 0xFF;
+  _page[payload() + 1] = check >> 8;
+  int rv = _eeprom.writeBlock((_firstPage + page) * _pageSize, _page, _pageSize);
+  if ((rv == 0) && verify) _verifyPolicy(page, check);
+  return rv;
+}
+
+
+//  read back of a written page from the device, a corrected page is
+//  rewritten once. returns false if the page is corrupt, the rewrite
+//  fails or the page does not hold check, the check word that was written.
+bool I2C_eeprom_checked::_verifyPage(const uint16_t page, const uint16_t check)
+{
+  uint8_t status = _loadPage(page, true);
+  if (status == I2C_EEPROM_PAGE_CORRECTED)
+  {
+    //  also replaces the check word by the one of the corrected payload.
+    if (_storePage(page, false) != 0) return false;
+  }
+  else if (status != I2C_EEPROM_PAGE_OK) return false;
+  return (_page[payload()] | (_page[payload() + 1] << 8)) == check;
+}
+
+
+//  read back according to the verify policy.
+void I2C_eeprom_checked::_verifyPolicy(const uint16_t page, const uint16_t check)
+{
+  if (_policy == I2C_EEPROM_VERIFY_SAMPLED)
+  {
+    if (++_sampleCount < _sampleRate) return;
+    _sampleCount = 0;
+    if (! _verifyPage(page, check)) _verifyFailures++;
+  }
+  else if (_policy == I2C_EEPROM_VERIFY_DEFERRED)
+  {
+    for (uint8_t i = 0; i < _deferredCount; i++)
+    {
+      if (_deferred[i] == page)
+      {
+        _deferredCheck[i] = check;
+        return;
+      }
+    }
+    if (_deferredCount == I2C_EEPROM_CHECKED_DEFERRED)
+    {
+      //  queue full, check the oldest now.
+      if (! _verifyPage(_deferred[0], _deferredCheck[0])) _verifyFailures++;
+      memmove(_deferred, _deferred + 1, (I2C_EEPROM_CHECKED_DEFERRED - 1) * sizeof(_deferred[0]));
+      memmove(_deferredCheck, _deferredCheck + 1, (I2C_EEPROM_CHECKED_DEFERRED - 1) * sizeof(_deferredCheck[0]));
+      _deferredCount--;
+    }
+    _deferred[_deferredCount] = page;
+    _deferredCheck[_deferredCount] = check;
+    _deferredCount++;
+  }
+}
+
+
+//  -- END OF FILE --
@@ -0,0 +1,119 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_checked.h
+// PURPOSE: self checking page format (CRC-16 or SECDED) for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  Every physical page holds (pageSize - 2) payload bytes followed by a
+//  16 bit check word, so reads validate (and with SECDED correct single
+//  bit errors) without a separate read back verify.
+//  Addresses in read() / write() are logical payload addresses.
+//  A page that is completely 0xFF (erased) reads as valid 0xFF payload.
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+
+//  check word modes
+#define I2C_EEPROM_CHECK_CRC16          0   //  detects, CRC-16/CCITT
+#define I2C_EEPROM_CHECK_SECDED         1   //  corrects 1 bit, detects 2 bit errors
+
+//  page status
+#define I2C_EEPROM_PAGE_OK              0
+#define I2C_EEPROM_PAGE_CORRECTED       1
+#define I2C_EEPROM_PAGE_CORRUPT         2
+#define I2C_EEPROM_PAGE_READ_ERROR      3
+
+//  write() status besides I2C status, 14 = read of a partial page failed
+#define I2C_EEPROM_CHECKED_CORRUPT      16  //  partial page is corrupt, not rewritten
+
+//  verify policy for writes
+#define I2C_EEPROM_VERIFY_NONE          0
+#define I2C_EEPROM_VERIFY_SAMPLED       1   //  every n-th page write is read back
+#define I2C_EEPROM_VERIFY_DEFERRED      2   //  pages are queued for verifyPending()
+
+#ifndef I2C_EEPROM_CHECKED_MAXPAGE
+#define I2C_EEPROM_CHECKED_MAXPAGE      128
+#endif
+
+#ifndef I2C_EEPROM_CHECKED_DEFERRED
+#define I2C_EEPROM_CHECKED_DEFERRED     8
+#endif
+
+
+//  CRC-16/CCITT-FALSE, poly 0x1021
+uint16_t I2C_eeprom_crc16(const uint8_t * data, const uint16_t length, uint16_t crc = 0xFFFF);
+
+
+class I2C_eeprom_checked
+{
+public:
+  //  uses pages [firstPage, firstPage + pages) of eeprom.
+  I2C_eeprom_checked(I2C_eeprom & eeprom, const uint16_t firstPage, const uint16_t pages,
+                     const uint8_t mode = I2C_EEPROM_CHECK_CRC16);
+
+  uint16_t size();       //  logical bytes
+  uint16_t pages();
+  uint8_t  payload();    //  logical bytes per page
+  uint8_t  getMode();
+  I2C_eeprom & getEEPROM();
+
+  //  returns bytes read, stops at the first page that cannot be read or corrected.
+  uint16_t read(const uint16_t address, uint8_t * buffer, const uint16_t length);
+  //  partial pages are read, merged and rewritten with a new check word.
+  //  a partial page that cannot be read or corrected is not rewritten.
+  //  returns I2C status, 0 = OK, 12 = beyond size(), 14 = read failed,
+  //  I2C_EEPROM_CHECKED_CORRUPT
+  int      write(const uint16_t address, const uint8_t * buffer, const uint16_t length);
+
+  //  page level, payload holds payload() bytes.
+  //  returns page status
+  uint8_t  readPage(const uint16_t page, uint8_t * payload);
+  int      writePage(const uint16_t page, const uint8_t * payload);
+  //  validates a page as stored on the device, repair rewrites a corrected page.
+  uint8_t  checkPage(const uint16_t page, const bool repair = true);
+
+  void     setVerifyPolicy(const uint8_t policy, const uint8_t sampleRate = 8);
+  uint8_t  getVerifyPolicy();
+  //  checks the queued pages, returns the number that failed.
+  //  a verify fails if the page is corrupt or does not hold the check word
+  //  just written, e.g. a dropped write.
+  uint8_t  verifyPending();
+
+  uint32_t getCorrected();
+  uint32_t getCorrupt();
+  uint32_t getVerifyFailures();
+  uint8_t  getLastStatus();
+
+private:
+  I2C_eeprom & _eeprom;
+  uint16_t _firstPage;
+  uint16_t _pages;
+  uint8_t  _mode;
+  uint8_t  _pageSize;
+
+  uint8_t  _policy     = I2C_EEPROM_VERIFY_NONE;
+  uint8_t  _sampleRate = 8;
+  uint8_t  _sampleCount = 0;
+  //  written pages and their check word, see verifyPending()
+  uint16_t _deferred[I2C_EEPROM_CHECKED_DEFERRED];
+  uint16_t _deferredCheck[I2C_EEPROM_CHECKED_DEFERRED];
+  uint8_t  _deferredCount = 0;
+
+  uint32_t _corrected = 0;
+  uint32_t _corrupt   = 0;
+  uint32_t _verifyFailures = 0;
+  uint8_t  _lastStatus = I2C_EEPROM_PAGE_OK;
+
+  uint8_t  _page[I2C_EEPROM_CHECKED_MAXPAGE];
+
+  uint16_t _check(const uint8_t * data, const uint8_t length);
+  uint8_t  _decode(uint8_t * data, const uint8_t length);
+  uint8_t  _loadPage(const uint16_t page, const bool uncached = false);
+  int      _storePage(const uint16_t page, const bool verify = true);
+  bool     _verifyPage(const uint16_t page, const uint16_t check);
+  void     _verifyPolicy(const uint16_t page, const uint16_t check);
+};
+
+
+//  -- END OF FILE --
@@ -0,0 +1,387 @@
+//
+//    FILE: I2C_eeprom_fs.cpp
+// PURPOSE: minimal file system with page aligned extents for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_fs.h"
+
+
+//  Superblock, first 16 bytes of the directory
+//   0  "EEFS"          magic
+//   4  version
+//   5  entries
+//   6  page size       uint16_t
+//   8  first page      uint16_t
+//  10  reserved
+#define I2C_EEPROM_FS_ENTRY         16
+
+static_assert(sizeof(I2C_eeprom_fs_entry) == I2C_EEPROM_FS_ENTRY, "directory entry must be 16 bytes");
+
+
+I2C_eeprom_fs::I2C_eeprom_fs(I2C_eeprom & eeprom) : _eeprom(eeprom)
+{
+}
+
+
+bool I2C_eeprom_fs::mount(bool IDPage)
+{
+  _mounted = false;
+  uint8_t super[I2C_EEPROM_FS_ENTRY];
+  if (_eeprom.readBlock(0, super, I2C_EEPROM_FS_ENTRY, IDPage) != I2C_EEPROM_FS_ENTRY) return false;
+  if ((memcmp(super, "EEFS", 4) != 0) || (super[4] != I2C_EEPROM_FS_VERSION)) return false;
+
+  _IDPage    = IDPage;
+  _entries   = super[5];
+  _pageSize  = super[6] | (super[7] << 8);
+  _firstPage = super[8] | (super[9] << 8);
+  _lastPage  = _eeprom.getDeviceSize() / _eeprom.getPageSize();
+  if ((_entries > I2C_EEPROM_FS_MAX_FILES) || (_pageSize != _eeprom.getPageSize())) return false;
+
+  //  the whole directory in one readBlock()
+  uint16_t size = _entries * I2C_EEPROM_FS_ENTRY;
+  if (_eeprom.readBlock(I2C_EEPROM_FS_ENTRY, (uint8_t *) _dir, size, IDPage) != size) return false;
+  _dirty = 0;
+  _mounted = true;
+  return true;
+}
+
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom_fs::format(bool IDPage)
+{
+  uint16_t pageSize = _eeprom.getPageSize();
+  uint16_t entries = I2C_EEPROM_FS_MAX_FILES;
+  uint16_t firstPage = 0;
+  if (IDPage)
+  {
+    //  the directory takes the whole ID page, all pages hold data.
+    if (entries > pageSize / I2C_EEPROM_FS_ENTRY - 1) entries = pageSize / I2C_EEPROM_FS_ENTRY - 1;
+  }
+  else
+  {
+    firstPage = _pagesFor((entries + 1) * I2C_EEPROM_FS_ENTRY);
+  }
+
+  uint8_t super[I2C_EEPROM_FS_ENTRY];
+  memset(super, 0, sizeof(super));
+  memcpy(super, "EEFS", 4);
+  super[4] = I2C_EEPROM_FS_VERSION;
+  super[5] = entries;
+  super[6] = pageSize & 0xFF;
+  super[7] = pageSize >> 8;
+  super[8] = firstPage & 0xFF;
+  super[9] = firstPage >> 8;
+
+  memset(_dir, 0, sizeof(_dir));
+  int rv = _eeprom.setBlock(I2C_EEPROM_FS_ENTRY, 0, entries * I2C_EEPROM_FS_ENTRY, IDPage);
+  if (rv == 0) rv = _eeprom.writeBlock(0, super, I2C_EEPROM_FS_ENTRY, IDPage);
+  if (rv != 0) return rv;
+  return mount(IDPage) ? I2C_EEPROM_FS_OK : I2C_EEPROM_FS_NOT_MOUNTED;
+}
+
+
+bool I2C_eeprom_fs::isMounted()
+{
+  return _mounted;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  DIRECTORY
+//
+int8_t I2C_eeprom_fs::create(const char * name, const uint16_t capacity)
+{
+  _error = I2C_EEPROM_FS_NOT_MOUNTED;
+  if (! _mounted) return -1;
+  _error = I2C_EEPROM_FS_NAME;
+  if ((name == NULL) || (name[0] == 0) || (strlen(name) > I2C_EEPROM_FS_NAME_LENGTH)) return -1;
+  _error = I2C_EEPROM_FS_EXISTS;
+  if (open(name) >= 0) return -1;
+
+  int8_t handle = -1;
+  for (uint8_t i = 0; i < _entries; i++)
+  {
+    if (_dir[i].name[0] == 0)
+    {
+      handle = i;
+      break;
+    }
+  }
+  _error = I2C_EEPROM_FS_DIR_FULL;
+  if (handle < 0) return -1;
+
+  uint16_t pages = _pagesFor(capacity);
+  if (pages == 0) pages = 1;
+  uint32_t start = _findExtent(pages, -1);
+  _error = I2C_EEPROM_FS_NO_SPACE;
+  if (start == 0xFFFFFFFF) return -1;
+
+  I2C_eeprom_fs_entry & entry = _dir[handle];
+  memset(entry.name, 0, I2C_EEPROM_FS_NAME_LENGTH);
+  memcpy(entry.name, name, strlen(name));
+  entry.start  = start;
+  entry.pages  = pages;
+  entry.length = 0;
+  _error = _changed(handle);
+  return (_error == 0) ? handle : -1;
+}
+
+
+int8_t I2C_eeprom_fs::open(const char * name)
+{
+  if (! _mounted || (name == NULL)) return -1;
+  for (uint8_t i = 0; i < _entries; i++)
+  {
+    if ((_dir[i].name[0] != 0) && (strncmp(_dir[i].name, name, I2C_EEPROM_FS_NAME_LENGTH) == 0)) return i;
+  }
+  return -1;
+}
+
+
+int I2C_eeprom_fs::remove(const int8_t handle)
+{
+  if (! _valid(handle)) return _error;
+  memset(&_dir[handle], 0, I2C_EEPROM_FS_ENTRY);
+  return _changed(handle);
+}
+
+
+const char * I2C_eeprom_fs::name(const int8_t handle)
+{
+  if (! _valid(handle)) return "";
+  return _dir[handle].name;
+}
+
+
+uint16_t I2C_eeprom_fs::length(const int8_t handle)
+{
+  if (! _valid(handle)) return 0;
+  return _dir[handle].length;
+}
+
+
+uint16_t I2C_eeprom_fs::capacity(const int8_t handle)
+{
+  if (! _valid(handle)) return 0;
+  return _dir[handle].pages * _pageSize;
+}
+
+
+uint16_t I2C_eeprom_fs::address(const int8_t handle)
+{
+  if (! _valid(handle)) return 0;
+  return _dir[handle].start * _pageSize;
+}
+
+
+uint8_t I2C_eeprom_fs::count()
+{
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < _entries; i++)
+  {
+    if (_dir[i].name[0] != 0) n++;
+  }
+  return n;
+}
+
+
+uint16_t I2C_eeprom_fs::freePages()
+{
+  if (! _mounted) return 0;
+  uint16_t used = 0;
+  for (uint8_t i = 0; i < _entries; i++)
+  {
+    if (_dir[i].name[0] != 0) used += _dir[i].pages;
+  }
+  return _lastPage - _firstPage - used;
+}
+
+
+int I2C_eeprom_fs::getError()
+{
+  return _error;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  DATA
+//
+
+//  returns bytes read
+uint16_t I2C_eeprom_fs::read(const int8_t handle, const uint16_t offset, uint8_t * buffer, const uint16_t length)
+{
+  if (! _valid(handle)) return 0;
+  I2C_eeprom_fs_entry & entry = _dir[handle];
+  if (offset >= entry.length) return 0;
+  uint16_t len = length;
+  if (len > entry.length - offset) len = entry.length - offset;
+  return _eeprom.readBlock(entry.start * _pageSize + offset, buffer, len);
+}
+
+
+//  returns I2C status or file system error, 0 = OK
+int I2C_eeprom_fs::write(const int8_t handle, const uint16_t offset, const uint8_t * buffer, const uint16_t length)
+{
+  if (! _valid(handle)) return _error;
+  I2C_eeprom_fs_entry & entry = _dir[handle];
+  if ((uint32_t)offset + length > (uint32_t)entry.pages * _pageSize) return I2C_EEPROM_FS_RANGE;
+
+  //  extent is page aligned, so writeBlock() splits at page boundaries only.
+  int rv = _eeprom.writeBlock(entry.start * _pageSize + offset, buffer, length);
+  if (rv != 0) return rv;
+  if (offset + length > entry.length)
+  {
+    entry.length = offset + length;
+    return _changed(handle);
+  }
+  return 0;
+}
+
+
+int I2C_eeprom_fs::append(const int8_t handle, const uint8_t * buffer, const uint16_t length)
+{
+  if (! _valid(handle)) return _error;
+  uint32_t needed = (uint32_t)_dir[handle].length + length;
+  if (needed > 0xFFFF) return I2C_EEPROM_FS_RANGE;
+  if (needed > (uint32_t)_dir[handle].pages * _pageSize)
+  {
+    int rv = resize(handle, needed);
+    if (rv != 0) return rv;
+  }
+  return write(handle, _dir[handle].length, buffer, length);
+}
+
+
+int I2C_eeprom_fs::resize(const int8_t handle, const uint16_t capacity)
+{
+  if (! _valid(handle)) return _error;
+  I2C_eeprom_fs_entry & entry = _dir[handle];
+  uint16_t pages = _pagesFor(capacity);
+  if (pages == 0) pages = 1;
+  if (pages == entry.pages) return 0;
+
+  if (pages > entry.pages)
+  {
+    //  grow in place if possible, otherwise relocate the used bytes.
+    uint32_t start = _findExtent(pages, handle);
+    if (start == 0xFFFFFFFF) return I2C_EEPROM_FS_NO_SPACE;
+    if ((start != entry.start) && (entry.length > 0))
+    {
+      int rv = _eeprom.copy(entry.start * _pageSize, start * _pageSize, entry.length);
+      if (rv != 0) return rv;
+    }
+    entry.start = start;
+  }
+  entry.pages = pages;
+  if (entry.length > pages * _pageSize) entry.length = pages * _pageSize;
+  return _changed(handle);
+}
+
+
+int I2C_eeprom_fs::truncate(const int8_t handle, const uint16_t length)
+{
+  if (! _valid(handle)) return _error;
+  if (length >= _dir[handle].length) return 0;
+  _dir[handle].length = length;
+  return _changed(handle);
+}
+
+
+void I2C_eeprom_fs::setAutoSync(bool autoSync)
+{
+  _autoSync = autoSync;
+}
+
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom_fs::sync()
+{
+  for (uint8_t i = 0; i < _entries; i++)
+  {
+    if ((_dirty & (1U << i)) == 0) continue;
+    int rv = _writeEntry(i);
+    if (rv != 0) return rv;
+  }
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PRIVATE
+//
+bool I2C_eeprom_fs::_valid(const int8_t handle)
+{
+  _error = I2C_EEPROM_FS_NOT_MOUNTED;
+  if (! _mounted) return false;
+  _error = I2C_EEPROM_FS_NOT_FOUND;
+  if ((handle < 0) || (handle >= _entries) || (_dir[handle].name[0] == 0)) return false;
+  _error = 0;
+  return true;
+}
+
+
+//  first fit, the extent of skip is treated as free as copy() handles
+//  overlap, growing in place is tried first.
+//  returns first page or 0xFFFFFFFF if there is no room.
+uint32_t I2C_eeprom_fs::_findExtent(const uint16_t pages, const int8_t skip)
+{
+  bool inPlace = (skip >= 0);
+  uint32_t candidate = inPlace ? _dir[skip].start : _firstPage;
+
+  while (true)
+  {
+    bool fits = (candidate + pages <= _lastPage);
+    for (uint8_t i = 0; fits && (i < _entries); i++)
+    {
+      if ((i == skip) || (_dir[i].name[0] == 0)) continue;
+      uint32_t end = (uint32_t)_dir[i].start + _dir[i].pages;
+      if ((_dir[i].start < candidate + pages) && (end > candidate))
+      {
+        fits = false;
+        candidate = end;
+      }
+    }
+    if (fits) return candidate;
+    if (inPlace)
+    {
+      //  no room behind the file, search from the start.
+      inPlace = false;
+      candidate = _firstPage;
+    }
+    else if (candidate + pages > _lastPage)
+    {
+      return 0xFFFFFFFF;
+    }
+  }
+}
+
+
+int I2C_eeprom_fs::_changed(const int8_t handle)
+{
+  _dirty |= (1U << handle);
+  if (! _autoSync) return 0;
+  return _writeEntry(handle);
+}
+
+
+//  one entry is aligned within one page, so one write cycle.
+int I2C_eeprom_fs::_writeEntry(const uint8_t index)
+{
+  int rv = _eeprom.writeBlock((index + 1) * I2C_EEPROM_FS_ENTRY, (const uint8_t *) &_dir[index], I2C_EEPROM_FS_ENTRY, _IDPage);
+  if (rv == 0) _dirty &= ~(1U << index);
+  return rv;
+}
+
+
+uint16_t I2C_eeprom_fs::_pagesFor(const uint32_t bytes)
+{
+  uint16_t pageSize = _pageSize ? _pageSize : _eeprom.getPageSize();
+  return (bytes + pageSize - 1) / pageSize;
+}
+
+
+//  -- END OF FILE --
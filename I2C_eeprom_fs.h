@@ -0,0 +1,116 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_fs.h
+// PURPOSE: minimal file system with page aligned extents for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  Every file is one contiguous extent of whole pages, so a file offset has
+//  the same position in a page as its device address and appends split at
+//  page boundaries only. The directory (a 16 byte superblock followed by 16
+//  byte entries) lives in the first pages or in the ID page of "-D" devices.
+//  mount() caches it in RAM, open() / stat calls need no bus traffic.
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+
+#define I2C_EEPROM_FS_VERSION       1
+
+//  directory entries, excluding the superblock.
+//  the ID page holds (pageSize / 16 - 1) entries.
+#ifndef I2C_EEPROM_FS_MAX_FILES
+#define I2C_EEPROM_FS_MAX_FILES     15
+#endif
+
+#if I2C_EEPROM_FS_MAX_FILES > 16
+#error "I2C_EEPROM_FS_MAX_FILES max 16"
+#endif
+
+#define I2C_EEPROM_FS_NAME_LENGTH   10
+
+//  error codes, I2C status codes are passed on as is.
+#define I2C_EEPROM_FS_OK            0
+#define I2C_EEPROM_FS_NOT_MOUNTED   20
+#define I2C_EEPROM_FS_NOT_FOUND     21
+#define I2C_EEPROM_FS_EXISTS        22
+#define I2C_EEPROM_FS_DIR_FULL      23
+#define I2C_EEPROM_FS_NO_SPACE      24
+#define I2C_EEPROM_FS_RANGE         25
+#define I2C_EEPROM_FS_NAME          26
+
+
+//  on device format, little endian.
+struct I2C_eeprom_fs_entry
+{
+  char     name[I2C_EEPROM_FS_NAME_LENGTH];  //  not terminated if 10 chars, empty = free
+  uint16_t start;     //  first page
+  uint16_t pages;     //  extent in pages
+  uint16_t length;    //  bytes in use
+};
+
+
+class I2C_eeprom_fs
+{
+public:
+  I2C_eeprom_fs(I2C_eeprom & eeprom);
+
+  //  reads the directory into RAM, returns false if it is not formatted.
+  bool     mount(bool IDPage = false);
+  //  writes an empty directory and mounts it.
+  //  returns I2C status, 0 = OK
+  int      format(bool IDPage = false);
+  bool     isMounted();
+
+  //  returns handle >= 0, or -1 with the reason in getError().
+  int8_t   create(const char * name, const uint16_t capacity);
+  int8_t   open(const char * name);
+  int      remove(const int8_t handle);
+
+  //  RAM only
+  const char * name(const int8_t handle);   //  not terminated if 10 chars
+  uint16_t length(const int8_t handle);
+  uint16_t capacity(const int8_t handle);
+  uint16_t address(const int8_t handle);
+  uint8_t  count();
+  uint16_t freePages();
+  int      getError();
+
+  //  returns bytes read
+  uint16_t read(const int8_t handle, const uint16_t offset, uint8_t * buffer, const uint16_t length);
+  //  write within the capacity, extends the length if needed.
+  //  returns I2C status or file system error, 0 = OK
+  int      write(const int8_t handle, const uint16_t offset, const uint8_t * buffer, const uint16_t length);
+  //  grows the extent (in place or relocated) if needed.
+  int      append(const int8_t handle, const uint8_t * buffer, const uint16_t length);
+  //  new capacity in bytes, relocates the file if the next pages are in use.
+  int      resize(const int8_t handle, const uint16_t capacity);
+  int      truncate(const int8_t handle, const uint16_t length);
+
+  //  autoSync (default) writes a changed directory entry immediately,
+  //  otherwise only at sync(). one write cycle per entry.
+  void     setAutoSync(bool autoSync);
+  int      sync();
+
+private:
+  I2C_eeprom & _eeprom;
+  bool     _mounted  = false;
+  bool     _IDPage   = false;
+  bool     _autoSync = true;
+  int      _error    = 0;
+  uint8_t  _entries  = 0;   //  usable entries
+  uint16_t _pageSize = 0;
+  uint16_t _firstPage = 0;  //  first data page
+  uint16_t _lastPage  = 0;  //  one past the last data page
+  uint16_t _dirty     = 0;  //  bit per entry
+
+  I2C_eeprom_fs_entry _dir[I2C_EEPROM_FS_MAX_FILES];
+
+  bool     _valid(const int8_t handle);
+  uint32_t _findExtent(const uint16_t pages, const int8_t skip);
+  int      _changed(const int8_t handle);
+  int      _writeEntry(const uint8_t index);
+  uint16_t _pagesFor(const uint32_t bytes);
+};
+
+
+//  -- END OF FILE --
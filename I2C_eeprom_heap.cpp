@@ -0,0 +1,315 @@
+//
+//    FILE: I2C_eeprom_heap.cpp
+// PURPOSE: persistent heap allocator over a region of an I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_heap.h"
+
+
+//  Header, first 8 bytes of the region, followed by the used and start bitmaps
+//   0  "HP"            magic
+//   2  version
+//   3  unit size
+//   4  units           uint16_t
+//   6  reserved
+#define I2C_EEPROM_HEAP_HEADER        8
+
+//  bytes compared per step in commit()
+#define I2C_EEPROM_HEAP_CHUNK         16
+
+
+I2C_eeprom_heap::I2C_eeprom_heap(I2C_eeprom & eeprom, const uint16_t start, const uint16_t size, const uint8_t unitSize) :
+                 _eeprom(eeprom), _start(start), _unitSize(unitSize)
+{
+  _pageSize = _eeprom.getPageSize();
+  if ((_unitSize == 0) || (_unitSize & (_unitSize - 1)) || (_unitSize > _pageSize)) _unitSize = 16;
+  //  alignment is done in units, so the region starts on a unit boundary.
+  uint16_t skip = (_unitSize - _start % _unitSize) % _unitSize;
+  uint32_t length = (size > skip) ? size - skip : 0;
+  if ((uint32_t)_start + skip > 0xFFFF) length = 0;
+  else _start += skip;
+  //  the region must fit in the device.
+  if (_start >= _eeprom.getDeviceSize()) length = 0;
+  else if (_start + length > _eeprom.getDeviceSize()) length = _eeprom.getDeviceSize() - _start;
+  _units = length / _unitSize;
+  if (_units > I2C_EEPROM_HEAP_MAXUNITS) _units = I2C_EEPROM_HEAP_MAXUNITS;
+  _bytes = (_units + 7) / 8;
+  _metaUnits = (I2C_EEPROM_HEAP_HEADER + 2 * _bytes + _unitSize - 1) / _unitSize;
+}
+
+
+bool I2C_eeprom_heap::mount()
+{
+  _mounted = false;
+  uint8_t header[I2C_EEPROM_HEAP_HEADER];
+  if (_eeprom.readBlock(_start, header, I2C_EEPROM_HEAP_HEADER) != I2C_EEPROM_HEAP_HEADER) return false;
+  if ((header[0] != 'H') || (header[1] != 'P') || (header[2] != I2C_EEPROM_HEAP_VERSION)) return false;
+  if ((header[3] != _unitSize) || ((header[4] | (header[5] << 8)) != _units)) return false;
+  if (_metaUnits >= _units) return false;
+
+  uint16_t addr = _start + I2C_EEPROM_HEAP_HEADER;
+  if (_eeprom.readBlock(addr, _used, _bytes) != _bytes) return false;
+  if (_eeprom.readBlock(addr + _bytes, _head, _bytes) != _bytes) return false;
+  _dirtyFirst = 0xFF;
+  _dirtyLast  = 0;
+  _mounted = true;
+  return true;
+}
+
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom_heap::format()
+{
+  //  no room for allocations.
+  if (_metaUnits >= _units) return I2C_EEPROM_HEAP_NO_SPACE;
+
+  uint8_t header[I2C_EEPROM_HEAP_HEADER];
+  memset(header, 0, sizeof(header));
+  header[0] = 'H';
+  header[1] = 'P';
+  header[2] = I2C_EEPROM_HEAP_VERSION;
+  header[3] = _unitSize;
+  header[4] = _units & 0xFF;
+  header[5] = _units >> 8;
+
+  //  the header and bitmaps are the first allocation.
+  memset(_used, 0, sizeof(_used));
+  memset(_head, 0, sizeof(_head));
+  for (uint16_t u = 0; u < _metaUnits; u++) _set(_used, u, true);
+  _set(_head, 0, true);
+
+  uint16_t addr = _start + I2C_EEPROM_HEAP_HEADER;
+  int rv = _eeprom.writeBlock(addr, _used, _bytes);
+  if (rv == 0) rv = _eeprom.writeBlock(addr + _bytes, _head, _bytes);
+  if (rv == 0) rv = _eeprom.writeBlock(_start, header, I2C_EEPROM_HEAP_HEADER);
+  if (rv != 0) return rv;
+  return mount() ? I2C_EEPROM_HEAP_OK : I2C_EEPROM_HEAP_NOT_MOUNTED;
+}
+
+
+bool I2C_eeprom_heap::isMounted()
+{
+  return _mounted;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  ALLOCATION
+//
+
+//  returns handle, 0 = failed
+uint16_t I2C_eeprom_heap::alloc(const uint16_t size)
+{
+  _error = I2C_EEPROM_HEAP_NOT_MOUNTED;
+  if (! _mounted) return 0;
+  _error = I2C_EEPROM_HEAP_NO_SPACE;
+  if ((size == 0) || (size > _units * _unitSize)) return 0;
+
+  //  size class and alignment in bytes
+  uint16_t count = (size + _unitSize - 1) / _unitSize;
+  uint16_t align;
+  if (count * _unitSize <= _pageSize)
+  {
+    uint16_t n = 1;
+    while (n < count) n <<= 1;
+    count = n;
+    align = count * _unitSize;
+  }
+  else
+  {
+    uint16_t perPage = _pageSize / _unitSize;
+    count = (count + perPage - 1) / perPage * perPage;
+    align = _pageSize;
+  }
+
+  //  first fit on aligned device addresses.
+  uint16_t unit = _metaUnits;
+  uint16_t misalign = (_start + unit * _unitSize) % align;
+  if (misalign) unit += (align - misalign) / _unitSize;
+  uint16_t step = align / _unitSize;
+  for (; (uint32_t)unit + count <= _units; unit += step)
+  {
+    if (! _isFree(unit, count)) continue;
+    for (uint16_t u = unit; u < unit + count; u++)
+    {
+      _set(_used, u, true);
+      _set(_head, u, u == unit);
+    }
+    _error = I2C_EEPROM_HEAP_OK;
+    return _start + unit * _unitSize;
+  }
+  return 0;
+}
+
+
+int I2C_eeprom_heap::free(const uint16_t handle)
+{
+  int32_t unit = _unitOf(handle);
+  if (unit < 0) return _error;
+
+  _set(_head, unit, false);
+  do
+  {
+    _set(_used, unit, false);
+    unit++;
+  }
+  while ((unit < _units) && _get(_used, unit) && ! _get(_head, unit));
+  _error = I2C_EEPROM_HEAP_OK;
+  return _error;
+}
+
+
+uint16_t I2C_eeprom_heap::sizeOf(const uint16_t handle)
+{
+  int32_t unit = _unitOf(handle);
+  if (unit < 0) return 0;
+
+  uint16_t count = 1;
+  while ((unit + count < _units) && _get(_used, unit + count) && ! _get(_head, unit + count)) count++;
+  return count * _unitSize;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PERSISTENCE
+//
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom_heap::commit()
+{
+  if (! _mounted) return I2C_EEPROM_HEAP_NOT_MOUNTED;
+  if (_dirtyFirst > _dirtyLast) return 0;
+
+  uint16_t addr = _start + I2C_EEPROM_HEAP_HEADER + _dirtyFirst;
+  uint8_t length = _dirtyLast - _dirtyFirst + 1;
+  //  used bitmap first, a reset in between at most leaks units.
+  int rv = _update(addr, _used + _dirtyFirst, length);
+  if (rv == 0) rv = _update(addr + _bytes, _head + _dirtyFirst, length);
+  if (rv != 0) return rv;
+  _dirtyFirst = 0xFF;
+  _dirtyLast  = 0;
+  return 0;
+}
+
+
+bool I2C_eeprom_heap::isDirty()
+{
+  return _dirtyFirst <= _dirtyLast;
+}
+
+
+uint16_t I2C_eeprom_heap::units()
+{
+  return _units;
+}
+
+
+uint16_t I2C_eeprom_heap::unitSize()
+{
+  return _unitSize;
+}
+
+
+uint16_t I2C_eeprom_heap::freeBytes()
+{
+  return _units * _unitSize - usedBytes();
+}
+
+
+uint16_t I2C_eeprom_heap::usedBytes()
+{
+  uint16_t count = 0;
+  for (uint16_t u = 0; u < _units; u++)
+  {
+    if (_get(_used, u)) count++;
+  }
+  return count * _unitSize;
+}
+
+
+uint16_t I2C_eeprom_heap::largestFree()
+{
+  uint16_t largest = 0;
+  uint16_t run = 0;
+  for (uint16_t u = 0; u < _units; u++)
+  {
+    run = _get(_used, u) ? 0 : run + 1;
+    if (run > largest) largest = run;
+  }
+  return largest * _unitSize;
+}
+
+
+int I2C_eeprom_heap::getError()
+{
+  return _error;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PRIVATE
+//
+bool I2C_eeprom_heap::_get(const uint8_t * map, const uint16_t unit)
+{
+  return (map[unit / 8] >> (unit % 8)) & 1;
+}
+
+
+void I2C_eeprom_heap::_set(uint8_t * map, const uint16_t unit, const bool value)
+{
+  uint8_t index = unit / 8;
+  if (value) map[index] |= (1 << (unit % 8));
+  else       map[index] &= ~(1 << (unit % 8));
+  if (index < _dirtyFirst) _dirtyFirst = index;
+  if (index > _dirtyLast)  _dirtyLast  = index;
+}
+
+
+bool I2C_eeprom_heap::_isFree(const uint16_t unit, const uint16_t count)
+{
+  for (uint16_t u = unit; u < unit + count; u++)
+  {
+    if (_get(_used, u)) return false;
+  }
+  return true;
+}
+
+
+//  like updateBlock(), only chunks that differ are written, but with the
+//  status of every read and write.
+//  returns I2C status, 0 = OK, 14 = read failed
+int I2C_eeprom_heap::_update(const uint16_t memoryAddress, const uint8_t * buffer, const uint8_t length)
+{
+  uint8_t current[I2C_EEPROM_HEAP_CHUNK];
+  for (uint16_t offset = 0; offset < length; offset += I2C_EEPROM_HEAP_CHUNK)
+  {
+    uint8_t cnt = length - offset;
+    if (cnt > I2C_EEPROM_HEAP_CHUNK) cnt = I2C_EEPROM_HEAP_CHUNK;
+    if (_eeprom.readBlock(memoryAddress + offset, current, cnt) != cnt) return 14;
+    if (memcmp(current, buffer + offset, cnt) == 0) continue;
+    int rv = _eeprom.writeBlock(memoryAddress + offset, buffer + offset, cnt);
+    if (rv != 0) return rv;
+  }
+  return 0;
+}
+
+
+//  returns the first unit of a live allocation, or -1.
+int32_t I2C_eeprom_heap::_unitOf(const uint16_t handle)
+{
+  _error = I2C_EEPROM_HEAP_NOT_MOUNTED;
+  if (! _mounted) return -1;
+  _error = I2C_EEPROM_HEAP_INVALID;
+  if ((handle < _start) || ((handle - _start) % _unitSize)) return -1;
+  uint16_t unit = (handle - _start) / _unitSize;
+  //  the header is no allocation
+  if ((unit == 0) || (unit >= _units) || ! _get(_head, unit)) return -1;
+  return unit;
+}
+
+
+//  -- END OF FILE --
@@ -0,0 +1,103 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_heap.h
+// PURPOSE: persistent heap allocator over a region of an I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  The region is divided in units of unitSize bytes. A used bitmap and a
+//  start bitmap (first unit of every allocation) live at the start of the
+//  region and are mirrored in RAM at mount(), so alloc() / free() need no
+//  bus traffic. commit() writes the changed bitmap bytes with updateBlock().
+//
+//  size classes: up to a page an allocation is a power of 2 units, aligned
+//  to its size so it never straddles a page, larger allocations are whole
+//  pages starting on a page boundary.
+//  a handle is the device address of the allocation, 0 = invalid.
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+
+#define I2C_EEPROM_HEAP_VERSION       1
+
+//  units per region, 2 x (units / 8) bytes RAM
+#ifndef I2C_EEPROM_HEAP_MAXUNITS
+#define I2C_EEPROM_HEAP_MAXUNITS      512
+#endif
+
+#if I2C_EEPROM_HEAP_MAXUNITS > 2040
+#error "I2C_EEPROM_HEAP_MAXUNITS max 2040"
+#endif
+
+//  error codes, I2C status codes are passed on as is.
+#define I2C_EEPROM_HEAP_OK            0
+#define I2C_EEPROM_HEAP_NOT_MOUNTED   30
+#define I2C_EEPROM_HEAP_NO_SPACE      31
+#define I2C_EEPROM_HEAP_INVALID       32
+
+
+class I2C_eeprom_heap
+{
+public:
+  //  region [start, start + size), unitSize a power of 2 <= page size.
+  //  start is rounded up to a multiple of unitSize, the region shrinks by
+  //  the skipped bytes.
+  I2C_eeprom_heap(I2C_eeprom & eeprom, const uint16_t start, const uint16_t size, const uint8_t unitSize = 16);
+
+  //  reads the bitmaps into RAM, returns false if the region is not formatted
+  //  or formatted with another geometry.
+  bool     mount();
+  //  writes empty bitmaps and mounts.
+  //  returns I2C status, 0 = OK, I2C_EEPROM_HEAP_NO_SPACE if the region
+  //  does not hold more than the header and bitmaps.
+  int      format();
+  bool     isMounted();
+
+  //  returns handle, 0 with the reason in getError().
+  uint16_t alloc(const uint16_t size);
+  //  returns 0 = OK or I2C_EEPROM_HEAP_INVALID
+  int      free(const uint16_t handle);
+  //  allocated bytes after rounding, 0 = invalid handle.
+  uint16_t sizeOf(const uint16_t handle);
+
+  //  writes the changed bitmap bytes, until then the device holds the
+  //  state of the last commit().
+  //  returns I2C status, 0 = OK, 14 = read failed
+  int      commit();
+  bool     isDirty();
+
+  //  RAM only
+  uint16_t units();
+  uint16_t unitSize();
+  uint16_t freeBytes();
+  uint16_t usedBytes();
+  uint16_t largestFree();   //  largest free run, not considering alignment
+  int      getError();
+
+private:
+  I2C_eeprom & _eeprom;
+  uint16_t _start;
+  uint16_t _units;
+  uint8_t  _unitSize;
+  uint8_t  _bytes;          //  bytes per bitmap
+  uint16_t _metaUnits;      //  units taken by header and bitmaps
+  uint16_t _pageSize;
+  bool     _mounted = false;
+  int      _error   = 0;
+
+  //  dirty byte range of the bitmaps, first > last == clean
+  uint8_t  _dirtyFirst = 0xFF;
+  uint8_t  _dirtyLast  = 0;
+
+  uint8_t  _used[I2C_EEPROM_HEAP_MAXUNITS / 8];
+  uint8_t  _head[I2C_EEPROM_HEAP_MAXUNITS / 8];
+
+  bool     _get(const uint8_t * map, const uint16_t unit);
+  void     _set(uint8_t * map, const uint16_t unit, const bool value);
+  bool     _isFree(const uint16_t unit, const uint16_t count);
+  int32_t  _unitOf(const uint16_t handle);
+  int      _update(const uint16_t memoryAddress, const uint8_t * buffer, const uint8_t length);
+};
+
+
+//  -- END OF FILE --
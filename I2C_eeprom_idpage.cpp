@@ -0,0 +1,214 @@
+//
+//    FILE: I2C_eeprom_idpage.cpp
+// PURPOSE: typed records in the ID page of ST "-D" devices for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_idpage.h"
+#include "I2C_eeprom_checked.h"   //  I2C_eeprom_crc16()
+
+
+#define I2C_EEPROM_IDPAGE_FLAGS         3
+#define I2C_EEPROM_IDPAGE_SERIAL_OFFSET 4
+#define I2C_EEPROM_IDPAGE_DEVICESIZE    12
+#define I2C_EEPROM_IDPAGE_PAGESIZE      16
+#define I2C_EEPROM_IDPAGE_CRC           18
+
+
+I2C_eeprom_idpage::I2C_eeprom_idpage(I2C_eeprom & eeprom) : _eeprom(eeprom)
+{
+  //  the ID page has the size of a memory page.
+  _pageSize = _eeprom.getPageSize();
+  if (_pageSize > I2C_EEPROM_IDPAGE_MAXPAGE) _pageSize = I2C_EEPROM_IDPAGE_MAXPAGE;
+  memset(_image, 0xFF, sizeof(_image));
+}
+
+
+bool I2C_eeprom_idpage::load()
+{
+  _loaded = (_eeprom.readBlock(0, _image, _pageSize, true) == _pageSize);
+  _first = 0xFF;
+  _last  = 0;
+  return _loaded;
+}
+
+
+bool I2C_eeprom_idpage::isLoaded()
+{
+  return _loaded;
+}
+
+
+bool I2C_eeprom_idpage::isValid()
+{
+  if ((_image[0] != 'I') || (_image[1] != 'D') || (_image[2] != I2C_EEPROM_IDPAGE_VERSION)) return false;
+  uint16_t crc = _image[I2C_EEPROM_IDPAGE_CRC] | (_image[I2C_EEPROM_IDPAGE_CRC + 1] << 8);
+  return crc == _crc();
+}
+
+
+bool I2C_eeprom_idpage::isLocked()
+{
+  return _eeprom.isIDPageLocked();
+}
+
+
+void I2C_eeprom_idpage::format()
+{
+  uint8_t header[I2C_EEPROM_IDPAGE_HEADER];
+  memset(header, 0, sizeof(header));
+  header[0] = 'I';
+  header[1] = 'D';
+  header[2] = I2C_EEPROM_IDPAGE_VERSION;
+  uint32_t deviceSize = _eeprom.getDeviceSize();
+  for (uint8_t i = 0; i < 4; i++) header[I2C_EEPROM_IDPAGE_DEVICESIZE + i] = deviceSize >> (8 * i);
+  header[I2C_EEPROM_IDPAGE_PAGESIZE] = _pageSize;
+  _set(0, header, I2C_EEPROM_IDPAGE_HEADER);
+
+  uint8_t blank = 0xFF;
+  for (uint8_t offset = I2C_EEPROM_IDPAGE_HEADER; offset < _pageSize; offset++) _set(offset, &blank, 1);
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  RECORDS
+//
+uint8_t I2C_eeprom_idpage::getFlags()
+{
+  return _image[I2C_EEPROM_IDPAGE_FLAGS];
+}
+
+
+void I2C_eeprom_idpage::setFlags(const uint8_t flags)
+{
+  _set(I2C_EEPROM_IDPAGE_FLAGS, &flags, 1);
+}
+
+
+const uint8_t * I2C_eeprom_idpage::getSerial()
+{
+  return _image + I2C_EEPROM_IDPAGE_SERIAL_OFFSET;
+}
+
+
+void I2C_eeprom_idpage::setSerial(const uint8_t * serial, const uint8_t length)
+{
+  uint8_t buffer[I2C_EEPROM_IDPAGE_SERIAL];
+  memset(buffer, 0, sizeof(buffer));
+  memcpy(buffer, serial, (length < I2C_EEPROM_IDPAGE_SERIAL) ? length : I2C_EEPROM_IDPAGE_SERIAL);
+  _set(I2C_EEPROM_IDPAGE_SERIAL_OFFSET, buffer, I2C_EEPROM_IDPAGE_SERIAL);
+}
+
+
+uint32_t I2C_eeprom_idpage::getDeviceSize()
+{
+  uint32_t deviceSize = 0;
+  for (uint8_t i = 0; i < 4; i++) deviceSize |= (uint32_t)_image[I2C_EEPROM_IDPAGE_DEVICESIZE + i] << (8 * i);
+  return deviceSize;
+}
+
+
+uint16_t I2C_eeprom_idpage::getPageSize()
+{
+  return _image[I2C_EEPROM_IDPAGE_PAGESIZE] | (_image[I2C_EEPROM_IDPAGE_PAGESIZE + 1] << 8);
+}
+
+
+bool I2C_eeprom_idpage::matchesDevice()
+{
+  return (getDeviceSize() == _eeprom.getDeviceSize()) && (getPageSize() == _eeprom.getPageSize());
+}
+
+
+uint8_t I2C_eeprom_idpage::calibrationSize()
+{
+  return _pageSize - I2C_EEPROM_IDPAGE_HEADER;
+}
+
+
+bool I2C_eeprom_idpage::getCalibration(const uint8_t offset, void * buffer, const uint8_t length)
+{
+  if ((uint16_t)offset + length > calibrationSize()) return false;
+  memcpy(buffer, _image + I2C_EEPROM_IDPAGE_HEADER + offset, length);
+  return true;
+}
+
+
+bool I2C_eeprom_idpage::setCalibration(const uint8_t offset, const void * data, const uint8_t length)
+{
+  if ((uint16_t)offset + length > calibrationSize()) return false;
+  _set(I2C_EEPROM_IDPAGE_HEADER + offset, data, length);
+  return true;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  COMMIT
+//
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom_idpage::commit()
+{
+  if (! isDirty()) return 0;
+  if (_eeprom.isIDPageLocked()) return I2C_EEPROM_IDPAGE_IS_LOCKED;
+
+  uint16_t crc = _crc();
+  uint8_t data[2] = { (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8) };
+  _set(I2C_EEPROM_IDPAGE_CRC, data, 2);
+
+  //  without load() the CRC only matches the whole RAM image.
+  if (! _loaded)
+  {
+    _first = 0;
+    _last  = _pageSize - 1;
+  }
+  int rv = _eeprom.writeBlock(_first, _image + _first, _last - _first + 1, true);
+  if (rv != 0) return rv;
+  _loaded = true;
+  _first = 0xFF;
+  _last  = 0;
+  return 0;
+}
+
+
+bool I2C_eeprom_idpage::isDirty()
+{
+  return _first <= _last;
+}
+
+
+uint8_t * I2C_eeprom_idpage::image()
+{
+  return _image;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PRIVATE
+//
+void I2C_eeprom_idpage::_set(const uint8_t offset, const void * data, const uint8_t length)
+{
+  const uint8_t * bytes = (const uint8_t *) data;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    uint8_t index = offset + i;
+    if (_loaded && (_image[index] == bytes[i])) continue;
+    _image[index] = bytes[i];
+    if (index < _first) _first = index;
+    if (index > _last)  _last  = index;
+  }
+}
+
+
+//  CRC-16 over the page without the CRC field.
+uint16_t I2C_eeprom_idpage::_crc()
+{
+  uint16_t crc = I2C_eeprom_crc16(_image, I2C_EEPROM_IDPAGE_CRC);
+  return I2C_eeprom_crc16(_image + I2C_EEPROM_IDPAGE_HEADER, _pageSize - I2C_EEPROM_IDPAGE_HEADER, crc);
+}
+
+
+//  -- END OF FILE --
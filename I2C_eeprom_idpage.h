@@ -0,0 +1,90 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_idpage.h
+// PURPOSE: typed records in the ID page of ST "-D" devices for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  load() reads the whole ID page into RAM with one readBlock(), the getters
+//  need no bus traffic after that. Setters change the RAM image, commit()
+//  writes the changed span (incl. the CRC) with one writeBlock(), so with a
+//  Wire buffer of at least a page it is one page write.
+//
+//  ID page format, little endian
+//   0  "ID"            magic
+//   2  version
+//   3  flags           application defined
+//   4  serial          8 bytes
+//  12  device size     uint32_t
+//  16  page size       uint16_t
+//  18  CRC-16          over all other bytes of the page
+//  20  calibration     up to the end of the page
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+
+#define I2C_EEPROM_IDPAGE_VERSION       1
+#define I2C_EEPROM_IDPAGE_SERIAL        8
+#define I2C_EEPROM_IDPAGE_HEADER        20
+
+#ifndef I2C_EEPROM_IDPAGE_MAXPAGE
+#define I2C_EEPROM_IDPAGE_MAXPAGE       128
+#endif
+
+//  commit() on a locked ID page, no bus traffic.
+#define I2C_EEPROM_IDPAGE_IS_LOCKED     15
+
+
+class I2C_eeprom_idpage
+{
+public:
+  I2C_eeprom_idpage(I2C_eeprom & eeprom);
+
+  //  reads the ID page, returns true if all bytes were read.
+  bool     load();
+  bool     isLoaded();
+  //  magic, version and CRC match.
+  bool     isValid();
+  //  cached in I2C_eeprom, one probe per power cycle.
+  bool     isLocked();
+
+  //  initializes the RAM image: magic, version, geometry of the device,
+  //  zero serial and flags, calibration 0xFF. commit() writes it.
+  void     format();
+
+  //  RAM only
+  uint8_t  getFlags();
+  void     setFlags(const uint8_t flags);
+  const uint8_t * getSerial();
+  void     setSerial(const uint8_t * serial, const uint8_t length = I2C_EEPROM_IDPAGE_SERIAL);
+  uint32_t getDeviceSize();
+  uint16_t getPageSize();
+  //  true if the stored geometry matches the device.
+  bool     matchesDevice();
+
+  uint8_t  calibrationSize();
+  //  returns false if offset + length is beyond calibrationSize().
+  bool     getCalibration(const uint8_t offset, void * buffer, const uint8_t length);
+  bool     setCalibration(const uint8_t offset, const void * data, const uint8_t length);
+
+  //  writes the changed span, the whole page if load() was not called.
+  //  returns I2C status, 0 = OK, I2C_EEPROM_IDPAGE_IS_LOCKED
+  int      commit();
+  bool     isDirty();
+  uint8_t * image();
+
+private:
+  I2C_eeprom & _eeprom;
+  uint8_t  _pageSize;
+  bool     _loaded = false;
+  //  dirty span, first > last == clean
+  uint8_t  _first  = 0xFF;
+  uint8_t  _last   = 0;
+  uint8_t  _image[I2C_EEPROM_IDPAGE_MAXPAGE];
+
+  void     _set(const uint8_t offset, const void * data, const uint8_t length);
+  uint16_t _crc();
+};
+
+
+//  -- END OF FILE --
@@ -0,0 +1,220 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_layout.h
+// PURPOSE: compile time layout of typed fields and page batched commits for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  EXAMPLE
+//    typedef I2C_eeprom_schema<0x0100, 256, 64>        Config;   //  base, size, page size
+//    typedef I2C_eeprom_field<Config::start, uint32_t> SerialNumber;
+//    typedef I2C_eeprom_field<SerialNumber, float>     Gain;
+//
+//    I2C_eeprom_record<Config> config(ee);
+//    config.load();
+//    config.put<Gain>(1.25);
+//    config.commit();                                  //  one write per touched page
+//
+//  a field that fits in a page never straddles a page boundary,
+//  larger fields start on a page boundary.
+//  fields of another schema or beyond the size of the schema do not compile.
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+
+//  commit() status, the page size of the schema is not the one of the device.
+#define I2C_EEPROM_LAYOUT_PAGESIZE      17
+
+
+//  first offset >= offset where size bytes do not straddle pages needlessly.
+constexpr uint32_t I2C_eeprom_place(const uint32_t offset, const uint32_t size, const uint32_t pageSize)
+{
+  return (size >= pageSize)
+         ? ((offset + pageSize - 1) / pageSize * pageSize)
+         : ((offset % pageSize + size > pageSize) ? ((offset / pageSize + 1) * pageSize) : offset);
+}
+
+
+//  no <type_traits> on AVR
+template <typename A, typename B> struct I2C_eeprom_same       { static const bool value = false; };
+template <typename A>             struct I2C_eeprom_same<A, A> { static const bool value = true; };
+
+
+//  BASE     = first address of the area
+//  SIZE     = bytes reserved for the area
+//  PAGESIZE = page size of the device, see getPageSize()
+template <uint16_t BASE, uint16_t SIZE, uint16_t PAGESIZE>
+struct I2C_eeprom_schema
+{
+  static_assert((PAGESIZE & (PAGESIZE - 1)) == 0, "page size must be a power of 2");
+  static_assert((uint32_t)BASE + SIZE <= 65536UL, "schema beyond 64 KB");
+
+  static const uint16_t base     = BASE;
+  static const uint16_t size     = SIZE;
+  static const uint16_t pageSize = PAGESIZE;
+  static const uint16_t pages    = (BASE + SIZE - 1) / PAGESIZE - BASE / PAGESIZE + 1;
+
+  //  anchor for the first field.
+  struct start
+  {
+    typedef I2C_eeprom_schema schema;
+    static const uint16_t end = 0;
+  };
+};
+
+
+//  PREV = previous field or SCHEMA::start
+//  T    = trivially copyable type of the field
+template <typename PREV, typename T>
+struct I2C_eeprom_field
+{
+  typedef typename PREV::schema schema;
+  typedef T type;
+
+  //  offset relative to schema::base, placement uses absolute addresses.
+  static const uint16_t offset = I2C_eeprom_place(schema::base + PREV::end, sizeof(T), schema::pageSize) - schema::base;
+  static const uint16_t end    = offset + sizeof(T);
+
+  static_assert(end <= schema::size, "field does not fit in the schema");
+};
+
+
+template <typename SCHEMA>
+class I2C_eeprom_record
+{
+public:
+  I2C_eeprom_record(I2C_eeprom & eeprom, bool IDPage = false) : _eeprom(eeprom), _IDPage(IDPage)
+  {
+    memset(_image, 0, sizeof(_image));
+    _clear();
+  }
+
+
+  //  reads the whole area in one readBlock(), puts after load() need no bus reads at commit.
+  //  returns true if all bytes were read, false if the page size of the
+  //  schema does not match the device.
+  bool load()
+  {
+    if (SCHEMA::pageSize != _eeprom.getPageSize()) return false;
+    _loaded = (_eeprom.readBlock(SCHEMA::base, _image, SCHEMA::size, _IDPage) == SCHEMA::size);
+    _clear();
+    return _loaded;
+  }
+
+
+  template <typename FIELD>
+  typename FIELD::type get() const
+  {
+    static_assert(I2C_eeprom_same<typename FIELD::schema, SCHEMA>::value, "field of another schema");
+    typename FIELD::type value;
+    memcpy((void *) &value, _image + FIELD::offset, sizeof(value));
+    return value;
+  }
+
+
+  //  changes the RAM image only, marks the changed bytes for commit().
+  //  without load() every put byte counts as changed.
+  template <typename FIELD>
+  void put(const typename FIELD::type & value)
+  {
+    static_assert(I2C_eeprom_same<typename FIELD::schema, SCHEMA>::value, "field of another schema");
+    const uint8_t * data = (const uint8_t *) &value;
+    for (uint16_t i = 0; i < sizeof(value); i++)
+    {
+      uint16_t offset = FIELD::offset + i;
+      if (_loaded && (_image[offset] == data[i])) continue;
+      _image[offset] = data[i];
+      _mark(offset);
+    }
+  }
+
+
+  //  writes the changed span of every touched page with one writeBlock().
+  //  without load() the span is first read from the device: bytes between
+  //  the put fields keep their device value and unchanged ends are trimmed.
+  //  returns I2C status, 0 = OK, 14 = read failed, I2C_EEPROM_LAYOUT_PAGESIZE
+  int commit()
+  {
+    _writes = 0;
+    if (SCHEMA::pageSize != _eeprom.getPageSize()) return I2C_EEPROM_LAYOUT_PAGESIZE;
+    for (uint16_t p = 0; p < SCHEMA::pages; p++)
+    {
+      if (_first[p] > _last[p]) continue;
+      uint16_t first = _first[p];
+      uint16_t last  = _last[p];
+      if (! _loaded)
+      {
+        uint8_t current[SCHEMA::pageSize];
+        uint16_t length = last - first + 1;
+        if (_eeprom.readBlock(SCHEMA::base + first, current, length, _IDPage) != length) return 14;
+        for (uint16_t i = first; i <= last; i++)
+        {
+          if (! _isDirty(i)) _image[i] = current[i - _first[p]];
+        }
+        while ((first <= last) && (current[first - _first[p]] == _image[first])) first++;
+        while ((last > first) && (current[last - _first[p]] == _image[last])) last--;
+        if (first > last) continue;
+      }
+      int rv = _eeprom.writeBlock(SCHEMA::base + first, _image + first, last - first + 1, _IDPage);
+      if (rv != 0) return rv;
+      _writes++;
+    }
+    _clear();
+    return 0;
+  }
+
+
+  bool     isDirty()
+  {
+    for (uint16_t p = 0; p < SCHEMA::pages; p++)
+    {
+      if (_first[p] <= _last[p]) return true;
+    }
+    return false;
+  }
+  //  pages written by the last commit().
+  uint16_t getPageWrites() { return _writes; }
+  uint8_t * image()        { return _image; }
+
+
+private:
+  I2C_eeprom & _eeprom;
+  bool     _IDPage;
+  bool     _loaded = false;
+  uint16_t _writes = 0;
+  uint8_t  _image[SCHEMA::size];
+  //  dirty span per page, offsets relative to SCHEMA::base, first > last == clean.
+  uint16_t _first[SCHEMA::pages];
+  uint16_t _last[SCHEMA::pages];
+  //  dirty bit per byte, tells put bytes from gaps inside a span.
+  uint8_t  _dirty[(SCHEMA::size + 7) / 8];
+
+
+  void _clear()
+  {
+    for (uint16_t p = 0; p < SCHEMA::pages; p++)
+    {
+      _first[p] = 0xFFFF;
+      _last[p]  = 0;
+    }
+    memset(_dirty, 0, sizeof(_dirty));
+  }
+
+
+  bool _isDirty(const uint16_t offset)
+  {
+    return (_dirty[offset / 8] >> (offset % 8)) & 1;
+  }
+
+
+  void _mark(const uint16_t offset)
+  {
+    uint16_t p = (SCHEMA::base + offset) / SCHEMA::pageSize - SCHEMA::base / SCHEMA::pageSize;
+    _dirty[offset / 8] |= (1 << (offset % 8));
+    if (offset < _first[p]) _first[p] = offset;
+    if (offset > _last[p])  _last[p]  = offset;
+  }
+};
+
+
+//  -- END OF FILE --
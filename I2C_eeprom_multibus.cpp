@@ -0,0 +1,217 @@
+//
+//    FILE: I2C_eeprom_multibus.cpp
+// PURPOSE: runs reads and writes on I2C_eeprom instances on several buses concurrently
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_multibus.h"
+
+#if I2C_EEPROM_USE_STD_THREAD
+#include <thread>
+#endif
+
+
+I2C_eeprom_multibus::I2C_eeprom_multibus()
+{
+}
+
+
+int8_t I2C_eeprom_multibus::addWrite(I2C_eeprom & eeprom, const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length)
+{
+  //  the buffer of a write job is never written.
+  return _add(eeprom, I2C_EEPROM_MULTIBUS_WRITE, memoryAddress, (uint8_t *) buffer, length);
+}
+
+
+int8_t I2C_eeprom_multibus::addRead(I2C_eeprom & eeprom, const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length)
+{
+  return _add(eeprom, I2C_EEPROM_MULTIBUS_READ, memoryAddress, buffer, length);
+}
+
+
+void I2C_eeprom_multibus::clear()
+{
+  _count = 0;
+  _next  = 0;
+  _duration = 0;
+}
+
+
+//  returns true while jobs are pending.
+bool I2C_eeprom_multibus::step()
+{
+  uint32_t start = micros();
+  bool pending = false;
+  for (uint8_t n = 0; n < _count; n++)
+  {
+    uint8_t i = (_next + n) % _count;
+    if (_chunk(_jobs[i])) pending = true;
+  }
+  if (_count > 0) _next = (_next + 1) % _count;
+  _duration += micros() - start;
+  return pending;
+}
+
+
+//  returns the first I2C status that failed a job, 0 = OK
+int I2C_eeprom_multibus::run()
+{
+#if I2C_EEPROM_USE_STD_THREAD
+  uint32_t start = micros();
+  std::thread workers[I2C_EEPROM_MULTIBUS_JOBS];
+  TwoWire * wires[I2C_EEPROM_MULTIBUS_JOBS];
+  uint8_t threads = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    TwoWire * wire = _jobs[i].eeprom->getWire();
+    bool known = false;
+    for (uint8_t t = 0; t < threads; t++) known |= (wires[t] == wire);
+    if (known) continue;
+    wires[threads] = wire;
+    workers[threads] = std::thread(&I2C_eeprom_multibus::_runBus, this, wire);
+    threads++;
+  }
+  for (uint8_t t = 0; t < threads; t++) workers[t].join();
+  _duration += micros() - start;
+#else
+  while (step()) yield();
+#endif
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_jobs[i].status != 0) return _jobs[i].status;
+  }
+  return 0;
+}
+
+
+uint8_t I2C_eeprom_multibus::jobs()
+{
+  return _count;
+}
+
+
+uint8_t I2C_eeprom_multibus::buses()
+{
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    bool known = false;
+    for (uint8_t k = 0; k < i; k++)
+    {
+      known |= (_jobs[k].eeprom->getWire() == _jobs[i].eeprom->getWire());
+    }
+    if (! known) count++;
+  }
+  return count;
+}
+
+
+bool I2C_eeprom_multibus::isDone(const int8_t job)
+{
+  if ((job < 0) || (job >= _count)) return false;
+  return (_jobs[job].done == _jobs[job].length) || (_jobs[job].status != 0);
+}
+
+
+uint16_t I2C_eeprom_multibus::getDone(const int8_t job)
+{
+  if ((job < 0) || (job >= _count)) return 0;
+  return _jobs[job].done;
+}
+
+
+int I2C_eeprom_multibus::getStatus(const int8_t job)
+{
+  if ((job < 0) || (job >= _count)) return 0;
+  return _jobs[job].status;
+}
+
+
+uint32_t I2C_eeprom_multibus::getBytes()
+{
+  uint32_t bytes = 0;
+  for (uint8_t i = 0; i < _count; i++) bytes += _jobs[i].done;
+  return bytes;
+}
+
+
+uint32_t I2C_eeprom_multibus::getDuration()
+{
+  return _duration;
+}
+
+
+uint32_t I2C_eeprom_multibus::getBytesPerSecond()
+{
+  if (_duration == 0) return 0;
+  return (uint64_t) getBytes() * 1000000ULL / _duration;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PRIVATE
+//
+int8_t I2C_eeprom_multibus::_add(I2C_eeprom & eeprom, const uint8_t type, const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length)
+{
+  if (_count >= I2C_EEPROM_MULTIBUS_JOBS) return -1;
+  job & j  = _jobs[_count];
+  j.eeprom  = &eeprom;
+  j.type    = type;
+  j.address = memoryAddress;
+  j.buffer  = buffer;
+  j.length  = length;
+  j.done    = 0;
+  j.status  = 0;
+  return _count++;
+}
+
+
+//  transfers the next chunk, up to the end of the page, if the device is ready.
+//  a chunk is one write transaction, so every write cycle can overlap others.
+//  returns true if the job is pending.
+bool I2C_eeprom_multibus::_chunk(job & j)
+{
+  if ((j.done == j.length) || (j.status != 0)) return false;
+  //  still in its write cycle, serve the other jobs first.
+  if (! j.eeprom->isReady()) return true;
+
+  uint16_t addr = j.address + j.done;
+  uint8_t  pageSize = j.eeprom->getPageSize();
+  uint16_t cnt = pageSize - (addr % pageSize);
+  if (cnt > I2C_EEPROM_MULTIBUS_CHUNK) cnt = I2C_EEPROM_MULTIBUS_CHUNK;
+  if (cnt > j.length - j.done) cnt = j.length - j.done;
+
+  if (j.type == I2C_EEPROM_MULTIBUS_WRITE)
+  {
+    j.status = j.eeprom->writeBlock(addr, j.buffer + j.done, cnt);
+  }
+  else if (j.eeprom->readBlock(addr, j.buffer + j.done, cnt) != cnt)
+  {
+    j.status = j.eeprom->getLastError();
+    if (j.status == 0) j.status = 1;
+  }
+  if (j.status == 0) j.done += cnt;
+  return (j.done < j.length) && (j.status == 0);
+}
+
+
+//  worker, round robin over the jobs on one bus.
+void I2C_eeprom_multibus::_runBus(TwoWire * wire)
+{
+  bool pending = true;
+  while (pending)
+  {
+    pending = false;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      if (_jobs[i].eeprom->getWire() != wire) continue;
+      if (_chunk(_jobs[i])) pending = true;
+    }
+    yield();
+  }
+}
+
+
+//  -- END OF FILE --
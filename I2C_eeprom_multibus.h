@@ -0,0 +1,100 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_multibus.h
+// PURPOSE: runs reads and writes on I2C_eeprom instances on several buses concurrently
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  I2C_eeprom_multibus engine;
+//  engine.addWrite(ee0, 0, data0, 4096);       //  ee0 on Wire
+//  engine.addWrite(ee1, 0, data1, 4096);       //  ee1 on Wire1
+//  engine.run();
+//  engine.getBytesPerSecond();
+//
+//  Jobs are split in chunks that fit one write transaction. On bare metal step() / run()
+//  interleave the chunks of all jobs round robin and skip a device that is
+//  still in its write cycle, so the write cycles of all devices overlap.
+//  With I2C_EEPROM_USE_STD_THREAD == 1 run() starts one std::thread per
+//  TwoWire bus, so the transfers on different buses overlap too.
+//  A TwoWire bus is only used by one thread at a time.
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+
+//  max bytes per chunk, one write transaction, see I2C_BUFFERSIZE
+#ifndef I2C_EEPROM_MULTIBUS_CHUNK
+#if defined(ESP32) || defined(ESP8266) || defined(PICO_RP2040)
+#define I2C_EEPROM_MULTIBUS_CHUNK     128
+#else
+#define I2C_EEPROM_MULTIBUS_CHUNK     30
+#endif
+#endif
+
+#ifndef I2C_EEPROM_MULTIBUS_JOBS
+#define I2C_EEPROM_MULTIBUS_JOBS      8
+#endif
+
+//  Linux, ESP32 (pthreads) or other RTOS with std::thread
+#ifndef I2C_EEPROM_USE_STD_THREAD
+#define I2C_EEPROM_USE_STD_THREAD     0
+#endif
+
+#define I2C_EEPROM_MULTIBUS_READ      0
+#define I2C_EEPROM_MULTIBUS_WRITE     1
+
+
+class I2C_eeprom_multibus
+{
+public:
+  I2C_eeprom_multibus();
+
+  //  buffers must stay valid until the job is done.
+  //  returns job index, or -1 if the queue is full.
+  int8_t   addWrite(I2C_eeprom & eeprom, const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length);
+  int8_t   addRead(I2C_eeprom & eeprom, const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length);
+  //  removes all jobs and resets the statistics.
+  void     clear();
+
+  //  one chunk for every job whose device is ready.
+  //  returns true while jobs are pending.
+  bool     step();
+  //  runs all jobs to the end.
+  //  returns the first I2C status that failed a job, 0 = OK
+  int      run();
+
+  uint8_t  jobs();
+  uint8_t  buses();      //  distinct TwoWire buses in the queue
+  bool     isDone(const int8_t job);
+  uint16_t getDone(const int8_t job);     //  bytes transferred
+  int      getStatus(const int8_t job);   //  I2C status, 0 = OK
+
+  //  totals of the jobs since clear()
+  uint32_t getBytes();
+  uint32_t getDuration();                 //  microseconds in step() / run()
+  uint32_t getBytesPerSecond();
+
+private:
+  struct job
+  {
+    I2C_eeprom * eeprom;
+    uint8_t  type;
+    uint16_t address;
+    uint8_t * buffer;
+    uint16_t length;
+    uint16_t done;
+    int      status;
+  };
+
+  job      _jobs[I2C_EEPROM_MULTIBUS_JOBS];
+  uint8_t  _count = 0;
+  uint8_t  _next  = 0;      //  round robin start
+  uint32_t _duration = 0;
+
+  int8_t   _add(I2C_eeprom & eeprom, const uint8_t type, const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length);
+  //  returns true if the job is pending.
+  bool     _chunk(job & j);
+  void     _runBus(TwoWire * wire);
+};
+
+
+//  -- END OF FILE --
@@ -0,0 +1,212 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_queue.h
+// PURPOSE: lock free single producer single consumer write queue for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  I2C_eeprom_queue<16> queue;             //  16 records of max 8 bytes
+//
+//  void faultISR()
+//  {
+//    queue.push(0x0100 + code, &value, 1); //  constant time, no bus access
+//  }
+//
+//  void loop()
+//  {
+//    queue.drain(ee);                      //  merges records per page
+//  }
+//
+//  One producer (ISR or thread) and one consumer (the foreground calling
+//  drain()). The indices are single bytes accessed with acquire / release
+//  atomics, byte loads and stores are atomic on every target incl. AVR.
+//  A record that does not fit is dropped and counted in getOverflows().
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+
+//  bytes per page in the drain() staging buffer
+#ifndef I2C_EEPROM_QUEUE_MAXPAGE
+#define I2C_EEPROM_QUEUE_MAXPAGE      128
+#endif
+
+
+//  CAPACITY = records, power of 2, max 128
+//  PAYLOAD  = max bytes per record
+template <uint8_t CAPACITY, uint8_t PAYLOAD = 8>
+class I2C_eeprom_queue
+{
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of 2");
+  static_assert((CAPACITY > 0) && (CAPACITY <= 128), "capacity max 128");
+
+public:
+  //  producer side, constant time.
+  //  returns false if the queue is full or length > PAYLOAD.
+  bool push(const uint16_t memoryAddress, const void * data, const uint8_t length)
+  {
+    uint8_t head = _head;   //  only the producer writes _head
+    uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+    if ((length > PAYLOAD) || ((uint8_t)(head - tail) >= CAPACITY))
+    {
+      _overflows++;
+      return false;
+    }
+    record & r = _ring[head & (CAPACITY - 1)];
+    r.address = memoryAddress;
+    r.length  = length;
+    memcpy(r.data, data, length);
+    __atomic_store_n(&_head, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+    return true;
+  }
+
+
+  //  consumer side, writes up to maxRecords queued records. bytes of the
+  //  same page are merged (newest wins), every page is one writeBlock().
+  //  On failure the records stay queued, a retry rewrites the same values.
+  //  returns I2C status, 0 = OK, 14 = read failed
+  int drain(I2C_eeprom & eeprom, const uint8_t maxRecords = CAPACITY)
+  {
+    uint8_t tail = _tail;   //  only the consumer writes _tail
+    uint8_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+    uint8_t count = head - tail;
+    if (count > maxRecords) count = maxRecords;
+    if (count == 0) return 0;
+
+    uint8_t pageSize = eeprom.getPageSize();
+    if (pageSize > I2C_EEPROM_QUEUE_MAXPAGE) pageSize = I2C_EEPROM_QUEUE_MAXPAGE;
+
+    //  every page is staged once, at the first record that touches it.
+    for (uint8_t i = 0; i < count; i++)
+    {
+      const record & r = _at(tail + i);
+      if (r.length == 0) continue;
+      uint16_t first = r.address / pageSize;
+      uint16_t last  = (r.address + r.length - 1) / pageSize;
+      for (uint16_t page = first; page <= last; page++)
+      {
+        if (_touched(tail, i, page, pageSize)) continue;
+        int rv = _writePage(eeprom, tail + i, count - i, page, pageSize);
+        if (rv != 0) return rv;
+      }
+    }
+    _drained += count;
+    __atomic_store_n(&_tail, (uint8_t)(tail + count), __ATOMIC_RELEASE);
+    return 0;
+  }
+
+
+  //  records queued, exact for the consumer.
+  uint8_t  count()
+  {
+    return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+  }
+  bool     isEmpty()    { return count() == 0; }
+  uint8_t  capacity()   { return CAPACITY; }
+
+  //  dropped records, written by the producer only.
+  uint16_t getOverflows()
+  {
+    //  a 16 bit read can tear on 8 bit targets, read until stable.
+    uint16_t a, b;
+    do
+    {
+      a = _overflows;
+      b = _overflows;
+    }
+    while (a != b);
+    return a;
+  }
+  uint32_t getDrained()    { return _drained; }
+  uint32_t getPageWrites() { return _pageWrites; }
+
+
+private:
+  struct record
+  {
+    uint16_t address;
+    uint8_t  length;
+    uint8_t  data[PAYLOAD];
+  };
+
+  record   _ring[CAPACITY];
+  uint8_t  _head = 0;                 //  free running, producer
+  uint8_t  _tail = 0;                 //  free running, consumer
+  volatile uint16_t _overflows = 0;   //  producer
+  uint32_t _drained    = 0;           //  consumer
+  uint32_t _pageWrites = 0;           //  consumer
+
+
+  const record & _at(const uint8_t index) { return _ring[index & (CAPACITY - 1)]; }
+
+
+  //  true if one of the first n records after tail touches page.
+  bool _touched(const uint8_t tail, const uint8_t n, const uint16_t page, const uint8_t pageSize)
+  {
+    for (uint8_t i = 0; i < n; i++)
+    {
+      const record & r = _at(tail + i);
+      if (r.length == 0) continue;
+      if ((r.address / pageSize <= page) && ((r.address + r.length - 1) / pageSize >= page)) return true;
+    }
+    return false;
+  }
+
+
+  //  copies the bytes of page from n records starting at index into
+  //  staging, newest wins, and marks them in mask.
+  void _stage(const uint8_t index, const uint8_t n, const uint32_t base, const uint8_t pageSize, uint8_t * staging, uint8_t * mask)
+  {
+    for (uint8_t i = 0; i < n; i++)
+    {
+      const record & r = _at(index + i);
+      for (uint8_t k = 0; k < r.length; k++)
+      {
+        uint32_t addr = (uint32_t)r.address + k;
+        if ((addr < base) || (addr >= base + pageSize)) continue;
+        uint8_t offset = addr - base;
+        staging[offset] = r.data[k];
+        mask[offset / 8] |= (1 << (offset % 8));
+      }
+    }
+  }
+
+
+  //  merges the bytes of page from n records starting at index and
+  //  writes first .. last dirty byte with one writeBlock(), gaps in
+  //  between are filled with the current content of the device.
+  int _writePage(I2C_eeprom & eeprom, const uint8_t index, const uint8_t n, const uint16_t page, const uint8_t pageSize)
+  {
+    uint8_t staging[I2C_EEPROM_QUEUE_MAXPAGE];
+    uint8_t mask[I2C_EEPROM_QUEUE_MAXPAGE / 8];
+    memset(mask, 0, sizeof(mask));
+    uint32_t base = (uint32_t)page * pageSize;
+    _stage(index, n, base, pageSize, staging, mask);
+
+    uint8_t first = pageSize;
+    uint8_t last  = 0;
+    uint8_t dirty = 0;
+    for (uint8_t offset = 0; offset < pageSize; offset++)
+    {
+      if ((mask[offset / 8] & (1 << (offset % 8))) == 0) continue;
+      if (first == pageSize) first = offset;
+      last = offset;
+      dirty++;
+    }
+    if (dirty == 0) return 0;
+    uint8_t length = last - first + 1;
+
+    if (dirty < length)
+    {
+      //  the read overwrites the staged bytes, stage them again.
+      if (eeprom.readBlockUncached(base + first, staging + first, length) != length) return 14;
+      _stage(index, n, base, pageSize, staging, mask);
+    }
+    int rv = eeprom.writeBlock(base + first, staging + first, length);
+    if (rv != 0) return rv;
+    _pageWrites++;
+    return 0;
+  }
+};
+
+
+//  -- END OF FILE --
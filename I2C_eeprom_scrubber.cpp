@@ -0,0 +1,187 @@
+//
+//    FILE: I2C_eeprom_scrubber.cpp
+// PURPOSE: incremental integrity scrubber for I2C_eeprom, runs in idle time
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_scrubber.h"
+
+
+I2C_eeprom_scrubber::I2C_eeprom_scrubber(I2C_eeprom & eeprom, const uint16_t firstPage, const uint16_t pages, uint16_t * hashes) :
+                     _eeprom(eeprom), _hashes(hashes), _firstPage(firstPage), _pages(pages)
+{
+  if (_hashes == NULL) _pages = 0;
+}
+
+
+I2C_eeprom_scrubber::I2C_eeprom_scrubber(I2C_eeprom_checked & checked) :
+                     _eeprom(checked.getEEPROM()), _checked(&checked), _firstPage(0), _pages(checked.pages())
+{
+  _learning = false;
+}
+
+
+//  returns pages checked.
+uint16_t I2C_eeprom_scrubber::step(const uint32_t budget)
+{
+  if (_pages == 0) return 0;
+  uint32_t start = micros();
+  uint16_t count = 0;
+  //  the next page must fit in the budget too.
+  while ((count == 0) || (micros() - start + _pageMicros <= budget))
+  {
+    if (! _eeprom.isReady()) break;
+    uint32_t pageStart = micros();
+    _checkPage(_position);
+    _pageMicros = micros() - pageStart;
+    count++;
+
+    if (++_position >= _pages)
+    {
+      _position = 0;
+      _passes++;
+      _learning = false;
+    }
+  }
+  return count;
+}
+
+
+void I2C_eeprom_scrubber::setRepair(const bool repair)
+{
+  _repair = repair;
+}
+
+
+bool I2C_eeprom_scrubber::update(const uint16_t page)
+{
+  if ((_hashes == NULL) || (page >= _pages)) return false;
+  return _hashPage(page, _hashes[page]);
+}
+
+
+void I2C_eeprom_scrubber::learn()
+{
+  _learning = (_hashes != NULL);
+  _position = 0;
+}
+
+
+void I2C_eeprom_scrubber::reset()
+{
+  _position = 0;
+  _passes   = 0;
+  _checks   = 0;
+  _repaired = 0;
+  _bad      = 0;
+  _badPages = 0;
+}
+
+
+uint16_t I2C_eeprom_scrubber::getPosition()
+{
+  return _position;
+}
+
+
+uint16_t I2C_eeprom_scrubber::getPages()
+{
+  return _pages;
+}
+
+
+uint32_t I2C_eeprom_scrubber::getPasses()
+{
+  return _passes;
+}
+
+
+uint8_t I2C_eeprom_scrubber::getProgress()
+{
+  if (_pages == 0) return 0;
+  return (uint32_t)_position * 100 / _pages;
+}
+
+
+uint32_t I2C_eeprom_scrubber::getPagesChecked()
+{
+  return _checks;
+}
+
+
+uint32_t I2C_eeprom_scrubber::getRepaired()
+{
+  return _repaired;
+}
+
+
+uint32_t I2C_eeprom_scrubber::getBadCount()
+{
+  return _bad;
+}
+
+
+uint8_t I2C_eeprom_scrubber::getBadPages()
+{
+  return _badPages;
+}
+
+
+int32_t I2C_eeprom_scrubber::getBadPage(const uint8_t index)
+{
+  if (index >= _badPages) return -1;
+  return _badList[index];
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PRIVATE
+//
+bool I2C_eeprom_scrubber::_hashPage(const uint16_t page, uint16_t & hash)
+{
+  uint8_t pageSize = _eeprom.getPageSize();
+  uint8_t buffer[I2C_EEPROM_CHECKED_MAXPAGE];
+  if (pageSize > I2C_EEPROM_CHECKED_MAXPAGE) pageSize = I2C_EEPROM_CHECKED_MAXPAGE;
+  uint16_t address = (_firstPage + page) * pageSize;
+  //  the device itself, never the read shadow.
+  if (_eeprom.readBlockUncached(address, buffer, pageSize) != pageSize) return false;
+  hash = I2C_eeprom_crc16(buffer, pageSize);
+  return true;
+}
+
+
+void I2C_eeprom_scrubber::_checkPage(const uint16_t page)
+{
+  _checks++;
+  if (_checked != NULL)
+  {
+    uint8_t status = _checked->checkPage(page, _repair);
+    if ((status == I2C_EEPROM_PAGE_CORRECTED) && _repair) _repaired++;
+    if (status >= I2C_EEPROM_PAGE_CORRUPT) _badPage(page);
+    return;
+  }
+
+  uint16_t hash;
+  if (! _hashPage(page, hash))
+  {
+    _badPage(page);
+    return;
+  }
+  if (_learning) _hashes[page] = hash;
+  else if (_hashes[page] != hash) _badPage(page);
+}
+
+
+void I2C_eeprom_scrubber::_badPage(const uint16_t page)
+{
+  _bad++;
+  for (uint8_t i = 0; i < _badPages; i++)
+  {
+    if (_badList[i] == page) return;
+  }
+  if (_badPages < I2C_EEPROM_SCRUB_BADLIST) _badList[_badPages++] = page;
+}
+
+
+//  -- END OF FILE --
@@ -0,0 +1,87 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_scrubber.h
+// PURPOSE: incremental integrity scrubber for I2C_eeprom, runs in idle time
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  void loop()
+//  {
+//    ...
+//    scrubber.step(500);     //  at most ~500 us per call
+//  }
+//
+//  Checks one page at a time, either with I2C_eeprom_checked::checkPage()
+//  (CRC-16 or SECDED in the page, corrected pages can be rewritten) or
+//  against a CRC-16 per page in a RAM array owned by the application,
+//  learned in the first pass. step() returns at once while the device
+//  is in its write cycle, so it never waits on the bus.
+
+
+#include "I2C_eeprom_checked.h"
+
+
+//  bad pages remembered, see getBadPage()
+#ifndef I2C_EEPROM_SCRUB_BADLIST
+#define I2C_EEPROM_SCRUB_BADLIST      8
+#endif
+
+
+class I2C_eeprom_scrubber
+{
+public:
+  //  RAM hash mode, pages [firstPage, firstPage + pages), hashes holds one
+  //  uint16_t per page and is filled by the first pass.
+  I2C_eeprom_scrubber(I2C_eeprom & eeprom, const uint16_t firstPage, const uint16_t pages, uint16_t * hashes);
+  //  checked mode, all pages of checked.
+  I2C_eeprom_scrubber(I2C_eeprom_checked & checked);
+
+  //  checks pages while the budget in microseconds allows, at least one
+  //  if the device is ready. returns pages checked.
+  uint16_t step(const uint32_t budget);
+
+  //  checked mode: rewrite pages with a corrected bit error (default true)
+  void     setRepair(const bool repair);
+  //  RAM hash mode: relearn the hash of a page after the application wrote it,
+  //  learn() relearns all pages in the next pass.
+  //  returns false if the page could not be read.
+  bool     update(const uint16_t page);
+  void     learn();
+  //  restarts at the first page, clears the bad page list and counters.
+  void     reset();
+
+  uint16_t getPosition();     //  next page to check
+  uint16_t getPages();
+  uint32_t getPasses();       //  completed full passes
+  uint8_t  getProgress();     //  of the current pass, in %
+  uint32_t getPagesChecked();
+  uint32_t getRepaired();
+  uint32_t getBadCount();     //  failed checks, including repeats
+  uint8_t  getBadPages();     //  distinct pages in the list
+  int32_t  getBadPage(const uint8_t index);   //  -1 = none
+
+private:
+  I2C_eeprom & _eeprom;
+  I2C_eeprom_checked * _checked = NULL;
+  uint16_t * _hashes = NULL;
+  uint16_t _firstPage;
+  uint16_t _pages;
+
+  bool     _repair   = true;
+  bool     _learning = true;
+  uint16_t _position = 0;
+  uint32_t _passes   = 0;
+  uint32_t _checks   = 0;
+  uint32_t _repaired = 0;
+  uint32_t _bad      = 0;
+  uint32_t _pageMicros = 0;   //  duration of the last page check
+
+  uint16_t _badList[I2C_EEPROM_SCRUB_BADLIST];
+  uint8_t  _badPages = 0;
+
+  bool     _hashPage(const uint16_t page, uint16_t & hash);
+  void     _checkPage(const uint16_t page);
+  void     _badPage(const uint16_t page);
+};
+
+
+//  -- END OF FILE --
@@ -0,0 +1,176 @@
+//
+//    FILE: I2C_eeprom_stream.cpp
+// PURPOSE: Arduino Stream over a range of an I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_stream.h"
+
+
+I2C_eeprom_stream::I2C_eeprom_stream(I2C_eeprom & eeprom, const uint16_t start, const uint16_t size, bool IDPage) :
+                   _eeprom(eeprom), _start(start), _size(size), _IDPage(IDPage)
+{
+}
+
+
+I2C_eeprom_stream::~I2C_eeprom_stream()
+{
+  flush();
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PRINT
+//
+size_t I2C_eeprom_stream::write(uint8_t value)
+{
+  if (_position >= _size) return 0;
+  uint16_t address = _start + _position;
+  uint16_t window = _window();
+
+  //  the dirty bytes are consecutive, a byte that does not follow them
+  //  (other window, seek or a read ahead hit in between) flushes them.
+  if ((_wLast > _wFirst) && (address != _wBase + _wLast))
+  {
+    if (_flushWrite() != 0) return 0;
+  }
+  if (_wLast == _wFirst)
+  {
+    _wBase = address - address % window;
+    _wFirst = _wLast = address - _wBase;
+  }
+  _wBuffer[address - _wBase] = value;
+  _wLast++;
+
+  //  keep the read ahead coherent.
+  if ((address >= _rBase) && (address < _rBase + _rLength))
+  {
+    _rBuffer[address - _rBase] = value;
+  }
+  _position++;
+
+  //  page filled.
+  if (_wLast == window)
+  {
+    if (_flushWrite() != 0) return 0;
+  }
+  return 1;
+}
+
+
+size_t I2C_eeprom_stream::write(const uint8_t * buffer, size_t length)
+{
+  size_t count = 0;
+  while ((count < length) && (write(buffer[count]) == 1)) count++;
+  return count;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  STREAM
+//
+int I2C_eeprom_stream::available()
+{
+  return _size - _position;
+}
+
+
+int I2C_eeprom_stream::read()
+{
+  return _fetch(true);
+}
+
+
+int I2C_eeprom_stream::peek()
+{
+  return _fetch(false);
+}
+
+
+void I2C_eeprom_stream::flush()
+{
+  _flushWrite();
+}
+
+
+bool I2C_eeprom_stream::seek(const uint16_t position)
+{
+  if (position > _size) return false;
+  if (_flushWrite() != 0) return false;
+  _position = position;
+  return true;
+}
+
+
+uint16_t I2C_eeprom_stream::position()
+{
+  return _position;
+}
+
+
+uint16_t I2C_eeprom_stream::size()
+{
+  return _size;
+}
+
+
+int I2C_eeprom_stream::getError()
+{
+  return _error;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  PRIVATE
+//
+uint16_t I2C_eeprom_stream::_window()
+{
+  uint16_t pageSize = _eeprom.getPageSize();
+  if (pageSize > I2C_EEPROM_STREAM_BUFFERSIZE) return I2C_EEPROM_STREAM_BUFFERSIZE;
+  return pageSize;
+}
+
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom_stream::_flushWrite()
+{
+  if (_wLast == _wFirst) return 0;
+  int rv = _eeprom.writeBlock(_wBase + _wFirst, _wBuffer + _wFirst, _wLast - _wFirst, _IDPage);
+  _wFirst = _wLast = 0;
+  if (rv != 0)
+  {
+    _error = rv;
+    //  content of the device is unknown.
+    _rLength = 0;
+  }
+  return rv;
+}
+
+
+//  returns -1 at the end of the range or on a read error.
+int I2C_eeprom_stream::_fetch(bool advance)
+{
+  if (_position >= _size) return -1;
+  uint16_t address = _start + _position;
+
+  if ((address < _rBase) || (address >= _rBase + _rLength))
+  {
+    //  pending writes must be on the device before reading it.
+    if (_flushWrite() != 0) return -1;
+    uint16_t length = _size - _position;
+    if (length > I2C_EEPROM_STREAM_READAHEAD) length = I2C_EEPROM_STREAM_READAHEAD;
+    _rBase = address;
+    _rLength = _eeprom.readBlock(address, _rBuffer, length, _IDPage);
+    if (_rLength == 0) return -1;
+  }
+  //  a hit is kept up to date by write(), no flush needed.
+  uint8_t value = _rBuffer[address - _rBase];
+  if (advance) _position++;
+  return value;
+}
+
+
+//  -- END OF FILE --
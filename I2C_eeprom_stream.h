@@ -0,0 +1,78 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_stream.h
+// PURPOSE: Arduino Stream over a range of an I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  print() / write() fill a write combining buffer that is written to the
+//  device when a page (or the buffer) is full, on seek() and on flush().
+//  read() / peek() are served from a sequential read ahead buffer.
+//  the destructor flushes pending writes.
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+
+//  write combining buffer, bytes are flushed per page, or per aligned
+//  buffer size if the page is larger. power of 2, max 128.
+#ifndef I2C_EEPROM_STREAM_BUFFERSIZE
+#define I2C_EEPROM_STREAM_BUFFERSIZE    64
+#endif
+
+//  max 255
+#ifndef I2C_EEPROM_STREAM_READAHEAD
+#define I2C_EEPROM_STREAM_READAHEAD     16
+#endif
+
+
+class I2C_eeprom_stream : public Stream
+{
+public:
+  //  stream over [start, start + size) of eeprom.
+  I2C_eeprom_stream(I2C_eeprom & eeprom, const uint16_t start, const uint16_t size, bool IDPage = false);
+  ~I2C_eeprom_stream();
+
+  //  Print
+  size_t   write(uint8_t value);
+  size_t   write(const uint8_t * buffer, size_t length);
+  using    Print::write;
+
+  //  Stream
+  int      available();
+  int      read();
+  int      peek();
+  void     flush();
+
+  //  position relative to start, flushes pending writes.
+  bool     seek(const uint16_t position);
+  uint16_t position();
+  uint16_t size();
+  //  I2C status of the last failed write, 0 = OK
+  int      getError();
+
+private:
+  I2C_eeprom & _eeprom;
+  uint16_t _start;
+  uint16_t _size;
+  bool     _IDPage;
+  uint16_t _position = 0;
+  int      _error    = 0;
+
+  //  write combining window [_wBase, _wBase + window), dirty bytes [_wFirst, _wLast)
+  uint8_t  _wBuffer[I2C_EEPROM_STREAM_BUFFERSIZE];
+  uint16_t _wBase  = 0;
+  uint8_t  _wFirst = 0;
+  uint8_t  _wLast  = 0;
+
+  //  read ahead [_rBase, _rBase + _rLength)
+  uint8_t  _rBuffer[I2C_EEPROM_STREAM_READAHEAD];
+  uint16_t _rBase   = 0;
+  uint8_t  _rLength = 0;
+
+  uint16_t _window();
+  int      _flushWrite();
+  int      _fetch(bool advance);
+};
+
+
+//  -- END OF FILE --
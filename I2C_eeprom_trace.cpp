@@ -0,0 +1,108 @@
+//
+//    FILE: I2C_eeprom_trace.cpp
+// PURPOSE: tracing hooks and latency histogram for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_trace.h"
+
+
+I2C_eeprom_histogram::I2C_eeprom_histogram()
+{
+  reset();
+}
+
+
+void I2C_eeprom_histogram::end(const uint8_t op, const uint32_t duration)
+{
+  record(op, duration);
+}
+
+
+void I2C_eeprom_histogram::event(const uint8_t event, const uint16_t memoryAddress, const uint16_t length,
+                                 const int status, const uint32_t duration)
+{
+  (void) memoryAddress;
+  (void) length;
+  bool transaction = (event == I2C_EEPROM_TRACE_WRITE) || (event == I2C_EEPROM_TRACE_READ);
+  if ((status != 0) && transaction) _errors++;
+  record(event, duration);
+}
+
+
+void I2C_eeprom_histogram::reset()
+{
+  memset(_buckets, 0, sizeof(_buckets));
+  memset(_max, 0, sizeof(_max));
+  _errors = 0;
+}
+
+
+void I2C_eeprom_histogram::record(const uint8_t id, const uint32_t duration)
+{
+  if (id >= I2C_EEPROM_TRACE_IDS) return;
+  uint8_t bucket = 0;
+  while ((duration >> (bucket + 1)) && (bucket < I2C_EEPROM_HISTOGRAM_BUCKETS - 1)) bucket++;
+  //  saturate instead of wrapping around.
+  if (_buckets[id][bucket] < 0xFFFF) _buckets[id][bucket]++;
+  if (duration > _max[id]) _max[id] = duration;
+}
+
+
+uint32_t I2C_eeprom_histogram::getCount(const uint8_t id)
+{
+  if (id >= I2C_EEPROM_TRACE_IDS) return 0;
+  uint32_t count = 0;
+  for (uint8_t b = 0; b < I2C_EEPROM_HISTOGRAM_BUCKETS; b++)
+  {
+    count += _buckets[id][b];
+  }
+  return count;
+}
+
+
+uint16_t I2C_eeprom_histogram::getBucket(const uint8_t id, const uint8_t bucket)
+{
+  if ((id >= I2C_EEPROM_TRACE_IDS) || (bucket >= I2C_EEPROM_HISTOGRAM_BUCKETS)) return 0;
+  return _buckets[id][bucket];
+}
+
+
+uint32_t I2C_eeprom_histogram::getMax(const uint8_t id)
+{
+  if (id >= I2C_EEPROM_TRACE_IDS) return 0;
+  return _max[id];
+}
+
+
+//  returns 0 if nothing is recorded.
+uint32_t I2C_eeprom_histogram::getPercentile(const uint8_t id, const float percentile)
+{
+  uint32_t count = getCount(id);
+  if (count == 0) return 0;
+  //  rank of the sample, rounded up.
+  uint32_t rank = (uint32_t)(count * percentile / 100.0 + 0.999);
+  if (rank == 0) rank = 1;
+
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < I2C_EEPROM_HISTOGRAM_BUCKETS - 1; b++)
+  {
+    seen += _buckets[id][b];
+    if (seen >= rank)
+    {
+      //  upper bound of the bucket, but never more than observed.
+      uint32_t upper = (2UL << b) - 1;
+      return (upper < _max[id]) ? upper : _max[id];
+    }
+  }
+  return _max[id];
+}
+
+
+uint32_t I2C_eeprom_histogram::getErrors()
+{
+  return _errors;
+}
+
+
+//  -- END OF FILE --
@@ -0,0 +1,99 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_trace.h
+// PURPOSE: tracing hooks and latency histogram for I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "Arduino.h"
+
+
+//  set to 0 on the command line to compile all tracing out.
+#ifndef I2C_EEPROM_TRACING
+#define I2C_EEPROM_TRACING              1
+#endif
+
+//  inner events, one per bus transaction or ready wait.
+#define I2C_EEPROM_TRACE_WRITE          0   //  _WriteBlock()
+#define I2C_EEPROM_TRACE_READ           1   //  _ReadBlock() and _verifyBlock()
+#define I2C_EEPROM_TRACE_WAIT           2   //  _waitEEReady()
+
+//  public operations
+#define I2C_EEPROM_OP_WRITEBYTE         3
+#define I2C_EEPROM_OP_WRITEBLOCK        4
+#define I2C_EEPROM_OP_SETBLOCK          5
+#define I2C_EEPROM_OP_READBYTE          6
+#define I2C_EEPROM_OP_READBLOCK         7
+#define I2C_EEPROM_OP_VERIFYBLOCK       8
+#define I2C_EEPROM_OP_UPDATEBYTE        9
+#define I2C_EEPROM_OP_UPDATEBLOCK       10
+#define I2C_EEPROM_OP_WRITEBYTEVERIFY   11
+#define I2C_EEPROM_OP_WRITEBLOCKVERIFY  12
+#define I2C_EEPROM_OP_SETBLOCKVERIFY    13
+#define I2C_EEPROM_OP_UPDATEBYTEVERIFY  14
+#define I2C_EEPROM_OP_UPDATEBLOCKVERIFY 15
+#define I2C_EEPROM_OP_COPY              16
+#define I2C_EEPROM_OP_MOVE              17
+
+//  inner event, one per retry, duration = backoff
+#define I2C_EEPROM_TRACE_RETRY          18
+
+#define I2C_EEPROM_TRACE_IDS            19
+
+
+//  bucket b counts durations in [2^b, 2^(b+1)) microseconds,
+//  bucket 0 includes 0 and 1, the last bucket is open ended.
+#ifndef I2C_EEPROM_HISTOGRAM_BUCKETS
+#define I2C_EEPROM_HISTOGRAM_BUCKETS    16
+#endif
+
+
+//  derive from this class and install it with I2C_eeprom::setTracer().
+//  all callbacks run synchronously inside the library call,
+//  durations are in microseconds.
+class I2C_eeprom_tracer
+{
+public:
+  virtual ~I2C_eeprom_tracer() {}
+  //  around the outermost public operation, nested calls are not reported.
+  virtual void begin(const uint8_t op) { (void) op; }
+  virtual void end(const uint8_t op, const uint32_t duration) { (void) op; (void) duration; }
+  //  one inner event, status is the I2C status (WRITE, READ, RETRY)
+  //  or 0 if the device acknowledged within tWR (WAIT).
+  virtual void event(const uint8_t event, const uint16_t memoryAddress, const uint16_t length,
+                     const int status, const uint32_t duration)
+  {
+    (void) event; (void) memoryAddress; (void) length; (void) status; (void) duration;
+  }
+};
+
+
+//  ready made tracer, one log2 bucketed histogram per operation and event.
+class I2C_eeprom_histogram : public I2C_eeprom_tracer
+{
+public:
+  I2C_eeprom_histogram();
+
+  void     end(const uint8_t op, const uint32_t duration);
+  void     event(const uint8_t event, const uint16_t memoryAddress, const uint16_t length,
+                 const int status, const uint32_t duration);
+
+  void     reset();
+  void     record(const uint8_t id, const uint32_t duration);
+  uint32_t getCount(const uint8_t id);
+  uint16_t getBucket(const uint8_t id, const uint8_t bucket);
+  uint32_t getMax(const uint8_t id);
+  //  upper bound in microseconds of the bucket holding the percentile,
+  //  e.g. getPercentile(I2C_EEPROM_OP_READBLOCK, 99.0).
+  uint32_t getPercentile(const uint8_t id, const float percentile);
+  //  number of WRITE / READ transactions that returned an I2C error.
+  uint32_t getErrors();
+
+private:
+  uint16_t _buckets[I2C_EEPROM_TRACE_IDS][I2C_EEPROM_HISTOGRAM_BUCKETS];
+  uint32_t _max[I2C_EEPROM_TRACE_IDS];
+  uint32_t _errors;
+};
+
+
+//  -- END OF FILE --
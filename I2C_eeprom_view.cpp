@@ -0,0 +1,118 @@
+//
+//    FILE: I2C_eeprom_view.cpp
+// PURPOSE: random access view with iterators over a range of an I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_view.h"
+
+
+/////////////////////////////////////////////////////////////
+//
+//  I2C_eeprom_ref
+//
+I2C_eeprom_ref::operator uint8_t() const
+{
+  return _view->get(_index);
+}
+
+
+I2C_eeprom_ref & I2C_eeprom_ref::operator = (const uint8_t value)
+{
+  _view->set(_index, value);
+  return *this;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  I2C_eeprom_view
+//
+I2C_eeprom_view::I2C_eeprom_view(I2C_eeprom & eeprom, const uint16_t start, const uint16_t size, bool IDPage) :
+                 _eeprom(eeprom), _start(start), _size(size), _IDPage(IDPage)
+{
+}
+
+
+I2C_eeprom_view::~I2C_eeprom_view()
+{
+  flush();
+}
+
+
+uint16_t I2C_eeprom_view::size()
+{
+  return _size;
+}
+
+
+I2C_eeprom_view::iterator I2C_eeprom_view::begin()
+{
+  return iterator(this, 0);
+}
+
+
+I2C_eeprom_view::iterator I2C_eeprom_view::end()
+{
+  return iterator(this, _size);
+}
+
+
+I2C_eeprom_ref I2C_eeprom_view::operator [] (const uint16_t index)
+{
+  return I2C_eeprom_ref(this, index);
+}
+
+
+uint8_t I2C_eeprom_view::get(const uint16_t index)
+{
+  if (index >= _size) return 0;
+  //  pending writes first, they are newer than the read ahead.
+  if ((index >= _wIndex) && (index < _wIndex + _wLength)) return _wBuffer[index - _wIndex];
+
+  if ((index < _rIndex) || (index >= _rIndex + _rLength))
+  {
+    uint16_t length = _size - index;
+    if (length > I2C_EEPROM_VIEW_BLOCK) length = I2C_EEPROM_VIEW_BLOCK;
+    _rIndex = index;
+    _rLength = _eeprom.readBlock(_start + index, _rBuffer, length, _IDPage);
+    if (_rLength == 0) return 0;  //  error, see getLastError()
+  }
+  return _rBuffer[index - _rIndex];
+}
+
+
+void I2C_eeprom_view::set(const uint16_t index, const uint8_t value)
+{
+  if (index >= _size) return;
+  bool inBatch = (index >= _wIndex) && (index < _wIndex + _wLength);
+  bool extends = (_wLength > 0) && (index == _wIndex + _wLength) && (_wLength < I2C_EEPROM_VIEW_BLOCK);
+  if (! inBatch && ! extends)
+  {
+    flush();
+    _wIndex = index;
+  }
+  _wBuffer[index - _wIndex] = value;
+  if (! inBatch) _wLength++;
+
+  if ((index >= _rIndex) && (index < _rIndex + _rLength)) _rBuffer[index - _rIndex] = value;
+}
+
+
+//  returns bytes written.
+uint16_t I2C_eeprom_view::flush()
+{
+  if (_wLength == 0) return 0;
+  uint16_t rv = _eeprom.updateBlock(_start + _wIndex, _wBuffer, _wLength, _IDPage);
+  _wLength = 0;
+  return rv;
+}
+
+
+void I2C_eeprom_view::invalidate()
+{
+  _rLength = 0;
+}
+
+
+//  -- END OF FILE --
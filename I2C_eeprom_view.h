@@ -0,0 +1,137 @@
+#pragma once
+//
+//    FILE: I2C_eeprom_view.h
+// PURPOSE: random access view with iterators over a range of an I2C_eeprom
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  I2C_eeprom_view view(ee, 0x1000, 256);
+//  for (uint8_t b : view) ...                          //  range for
+//  std::find(view.begin(), view.end(), 0x42);          //  where <iterator> exists
+//  std::copy(data, data + 16, view.begin());
+//  view[3] = 7;
+//  view.flush();                                       //  also done by the destructor
+//
+//  reads are served from a read ahead block filled by readBlock(),
+//  writes collect in a block of consecutive bytes written by updateBlock().
+
+
+#include "I2C_eeprom_wIDPage.h"
+
+#if defined(__has_include)
+#if __has_include(<iterator>)
+#include <iterator>
+#define I2C_EEPROM_VIEW_STL         1
+#endif
+#endif
+
+
+//  size of the read ahead block and the write batch, max 255
+#ifndef I2C_EEPROM_VIEW_BLOCK
+#define I2C_EEPROM_VIEW_BLOCK       16
+#endif
+
+
+class I2C_eeprom_view;
+
+
+//  proxy for one byte, converts to uint8_t, assignment writes through the view.
+class I2C_eeprom_ref
+{
+public:
+  I2C_eeprom_ref(I2C_eeprom_view * view, const uint16_t index) : _view(view), _index(index) {}
+
+  operator uint8_t() const;
+  I2C_eeprom_ref & operator = (const uint8_t value);
+  I2C_eeprom_ref & operator = (const I2C_eeprom_ref & other) { return *this = (uint8_t) other; }
+  //  swaps the bytes, not the proxies, e.g. for std::reverse()
+  friend void swap(I2C_eeprom_ref a, I2C_eeprom_ref b) { uint8_t t = a; a = (uint8_t) b; b = t; }
+
+private:
+  I2C_eeprom_view * _view;
+  uint16_t _index;
+};
+
+
+class I2C_eeprom_iterator
+{
+public:
+#ifdef I2C_EEPROM_VIEW_STL
+  typedef std::random_access_iterator_tag iterator_category;
+#endif
+  typedef uint8_t        value_type;
+  typedef int32_t        difference_type;
+  typedef I2C_eeprom_ref reference;
+  typedef void           pointer;
+
+  I2C_eeprom_iterator() : _view(NULL), _index(0) {}
+  I2C_eeprom_iterator(I2C_eeprom_view * view, const int32_t index) : _view(view), _index(index) {}
+
+  reference operator * () const                          { return I2C_eeprom_ref(_view, _index); }
+  reference operator [] (const difference_type n) const  { return I2C_eeprom_ref(_view, _index + n); }
+
+  I2C_eeprom_iterator & operator ++ ()                   { _index++; return *this; }
+  I2C_eeprom_iterator & operator -- ()                   { _index--; return *this; }
+  I2C_eeprom_iterator   operator ++ (int)                { I2C_eeprom_iterator t = *this; _index++; return t; }
+  I2C_eeprom_iterator   operator -- (int)                { I2C_eeprom_iterator t = *this; _index--; return t; }
+  I2C_eeprom_iterator & operator += (const difference_type n)      { _index += n; return *this; }
+  I2C_eeprom_iterator & operator -= (const difference_type n)      { _index -= n; return *this; }
+  I2C_eeprom_iterator   operator +  (const difference_type n) const { return I2C_eeprom_iterator(_view, _index + n); }
+  I2C_eeprom_iterator   operator -  (const difference_type n) const { return I2C_eeprom_iterator(_view, _index - n); }
+  friend I2C_eeprom_iterator operator + (const difference_type n, const I2C_eeprom_iterator & it) { return it + n; }
+  difference_type operator - (const I2C_eeprom_iterator & other) const { return _index - other._index; }
+
+  bool operator == (const I2C_eeprom_iterator & other) const { return _index == other._index; }
+  bool operator != (const I2C_eeprom_iterator & other) const { return _index != other._index; }
+  bool operator <  (const I2C_eeprom_iterator & other) const { return _index <  other._index; }
+  bool operator >  (const I2C_eeprom_iterator & other) const { return _index >  other._index; }
+  bool operator <= (const I2C_eeprom_iterator & other) const { return _index <= other._index; }
+  bool operator >= (const I2C_eeprom_iterator & other) const { return _index >= other._index; }
+
+private:
+  I2C_eeprom_view * _view;
+  int32_t _index;
+};
+
+
+class I2C_eeprom_view
+{
+public:
+  typedef I2C_eeprom_iterator iterator;
+
+  //  view over [start, start + size) of eeprom.
+  I2C_eeprom_view(I2C_eeprom & eeprom, const uint16_t start, const uint16_t size, bool IDPage = false);
+  ~I2C_eeprom_view();
+
+  uint16_t size();
+  iterator begin();
+  iterator end();
+  I2C_eeprom_ref operator [] (const uint16_t index);
+
+  //  index beyond size() reads 0 and ignores writes.
+  uint8_t  get(const uint16_t index);
+  void     set(const uint16_t index, const uint8_t value);
+
+  //  writes the pending batch with updateBlock(), returns bytes written.
+  uint16_t flush();
+  //  drops the read ahead block, e.g. after other code wrote the device.
+  void     invalidate();
+
+private:
+  I2C_eeprom & _eeprom;
+  uint16_t _start;
+  uint16_t _size;
+  bool     _IDPage;
+
+  //  read ahead block, view indices [_rIndex, _rIndex + _rLength)
+  uint8_t  _rBuffer[I2C_EEPROM_VIEW_BLOCK];
+  uint16_t _rIndex  = 0;
+  uint8_t  _rLength = 0;
+
+  //  pending consecutive writes, view indices [_wIndex, _wIndex + _wLength)
+  uint8_t  _wBuffer[I2C_EEPROM_VIEW_BLOCK];
+  uint16_t _wIndex  = 0;
+  uint8_t  _wLength = 0;
+};
+
+
+//  -- END OF FILE --
@@ -31,6 +31,49 @@
 #endif
 
 
+//  brackets a public operation, only the outermost one resets the error
+//  report and calls begin() and end() of the tracer if installed.
+//  the bus activity of nested operations is reported by event().
+class I2C_eeprom_opScope
+{
+public:
+  I2C_eeprom_opScope(I2C_eeprom * eeprom, const uint8_t op) : _eeprom(eeprom), _op(op)
+  {
+    if (_eeprom->_opDepth++ != 0) return;
+    _eeprom->_lastError = 0;
+    _eeprom->_lastErrorAddress = 0;
+    _eeprom->_lastRetries = 0;
+#if I2C_EEPROM_TRACING
+    if (_eeprom->_tracer == NULL) return;
+    _eeprom->_tracer->begin(_op);
+    _start = micros();
+#endif
+  }
+  ~I2C_eeprom_opScope()
+  {
+    if (--_eeprom->_opDepth != 0) return;
+#if I2C_EEPROM_TRACING
+    if (_eeprom->_tracer != NULL) _eeprom->_tracer->end(_op, micros() - _start);
+#endif
+  }
+private:
+  I2C_eeprom * _eeprom;
+  uint8_t  _op;
+  uint32_t _start = 0;
+};
+#define I2C_EEPROM_OP_SCOPE(op)   I2C_eeprom_opScope _opScope(this, op)
+
+
+#if I2C_EEPROM_TRACING
+#define I2C_EEPROM_TRACE_EVENT(id, addr, len, status, start) \
+  if (_tracer != NULL) _tracer->event(id, addr, len, status, micros() - start)
+#define I2C_EEPROM_TRACE_START    ((_tracer != NULL) ? micros() : 0)
+#else
+#define I2C_EEPROM_TRACE_EVENT(id, addr, len, status, start) ((void) (addr), (void) (status), (void) (start))
+#define I2C_EEPROM_TRACE_START    0
+#endif
+
+
 ////////////////////////////////////////////////////////////////////
 //
 //  PUBLIC FUNCTIONS
@@ -57,7 +100,7 @@ I2C_eeprom::I2C_eeprom(const uint8_t deviceAddress, const uint32_t deviceSize, b
 }
 
 
-bool I2C_eeprom::begin(int8_t writeProtectPin)
+bool I2C_eeprom::begin(int8_t writeProtectPin, uint32_t maxClock, int32_t scratchAddress)
 {
   //  if (_wire == 0) SPRNL("zero");  //  test #48
   _lastWrite = 0;
@@ -67,7 +110,9 @@ bool I2C_eeprom::begin(int8_t writeProtectPin)
     pinMode(_writeProtectPin, OUTPUT);
     preventWrite();
   }
-  return isConnected();
+  if (! isConnected()) return false;
+  if (maxClock > 0) calibrate(maxClock, scratchAddress);
+  return true;
 }
 
 
@@ -88,31 +133,48 @@ uint8_t I2C_eeprom::lockIDPage() {
     uint16_t memoryAddress = 0x400;
     const uint8_t data = {0b00000010};
     int rv = _WriteBlock(memoryAddress, &data, 1, true);
+    if (rv == 0) _idPageLock = I2C_EEPROM_IDPAGE_LOCKED;
     return rv;
   }
   return 13; // Unlucky dawg...
 }
 
-bool I2C_eeprom::isIDPageLocked() {
-  if (_autoWriteProtect)
+//  read lock status sequence of the data sheet: the lock address (as
+//  lockIDPage() uses) and a data byte, a locked ID page does not ACK the
+//  data byte (status 3). A repeated START instead of STOP aborts the
+//  write, the data byte has no lock bit in case the abort is not honoured.
+//  other errors leave the state I2C_EEPROM_IDPAGE_UNKNOWN.
+bool I2C_eeprom::isIDPageLocked(bool refresh) {
+  if (!_hasIDPage) return false;
+  if (refresh || (_idPageLock == I2C_EEPROM_IDPAGE_UNKNOWN))
   {
-    digitalWrite(_writeProtectPin, LOW);
-  }
+    _waitEEReady(true);
+    if (_autoWriteProtect && hasWriteProtectPin())
+    {
+      digitalWrite(_writeProtectPin, LOW);
+    }
 
-  _wire->beginTransmission(_idPageDeviceAddress);
-  _wire->write(0x01);
-  int rv = _wire->endTransmission();
-  Serial.print("Is Locked Test wire return code: ");
-  Serial.println(rv);
-  _wire->beginTransmission(_idPageDeviceAddress);
-  _wire->endTransmission();
-  
-  if (_autoWriteProtect)
-  {
-    digitalWrite(_writeProtectPin, HIGH);
+    _beginTransmission(0x400, true);
+    _wire->write(0x00);
+    int rv = _wire->endTransmission(false);
+    _wire->beginTransmission(_idPageDeviceAddress);
+    _wire->endTransmission();
+
+    if (_autoWriteProtect && hasWriteProtectPin())
+    {
+      digitalWrite(_writeProtectPin, HIGH);
+    }
+
+    if (rv == 0)      _idPageLock = I2C_EEPROM_IDPAGE_UNLOCKED;
+    else if (rv == 3) _idPageLock = I2C_EEPROM_IDPAGE_LOCKED;
+    else              _idPageLock = I2C_EEPROM_IDPAGE_UNKNOWN;
   }
-  
-  return rv;
+  return (_idPageLock == I2C_EEPROM_IDPAGE_LOCKED);
+}
+
+
+uint8_t I2C_eeprom::getIDPageLockState() {
+  return _idPageLock;
 }
 
 
@@ -124,6 +186,7 @@ bool I2C_eeprom::isIDPageLocked() {
 //  returns I2C status, 0 = OK
 int I2C_eeprom::writeByte(const uint16_t memoryAddress, const uint8_t data, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_WRITEBYTE);
   int rv = _WriteBlock(memoryAddress, &data, 1, IDPage);
   return rv;
 }
@@ -132,6 +195,7 @@ int I2C_eeprom::writeByte(const uint16_t memoryAddress, const uint8_t data, bool
 //  returns I2C status, 0 = OK
 int I2C_eeprom::setBlock(const uint16_t memoryAddress, const uint8_t data, const uint16_t length, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_SETBLOCK);
   uint8_t buffer[I2C_BUFFERSIZE];
   for (uint16_t i = 0; i < I2C_BUFFERSIZE; i++)
   {
@@ -145,6 +209,7 @@ int I2C_eeprom::setBlock(const uint16_t memoryAddress, const uint8_t data, const
 //  returns I2C status, 0 = OK
 int I2C_eeprom::writeBlock(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_WRITEBLOCK);
   int rv = _pageBlock(memoryAddress, buffer, length, true, IDPage);
   return rv;
 }
@@ -158,19 +223,12 @@ int I2C_eeprom::writeBlock(const uint16_t memoryAddress, const uint8_t * buffer,
 //  returns the value stored in memoryAddress
 uint8_t I2C_eeprom::readByte(const uint16_t memoryAddress, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_READBYTE);
   uint8_t rdata;
-  _ReadBlock(memoryAddress, &rdata, 1, IDPage);
-  int rv = _wire->endTransmission();
-  if (rv != 0)
+  if ((_shadow != NULL) && _shadowRead(memoryAddress, &rdata, 1, IDPage)) return rdata;
+  if (_ReadBlock(memoryAddress, &rdata, 1, IDPage) != 1)
   {
-//    if (_debug)
-//    {
-//      SPRN("mem addr r: ");
-//      SPRNH(memoryAddress, HEX);
-//      SPRN("\t");
-//      SPRNL(rv);
-//    }
-    return 0;  //  error
+    return 0;  //  error, see getLastError()
   }
   return rdata;
 }
@@ -179,26 +237,24 @@ uint8_t I2C_eeprom::readByte(const uint16_t memoryAddress, bool IDPage)
 //  returns bytes read.
 uint16_t I2C_eeprom::readBlock(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage)
 {
-  uint16_t addr = memoryAddress;
-  uint16_t len = length;
-  uint16_t rv = 0;
-  while (len > 0)
-  {
-    uint16_t cnt = I2C_BUFFERSIZE;
-    if (cnt > len) cnt = len;
-    rv     += _ReadBlock(addr, buffer, cnt, IDPage);
-    addr   += cnt;
-    buffer += cnt;
-    len    -= cnt;
-  }
-  _wire->endTransmission();
-  return rv;
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_READBLOCK);
+  if ((_shadow != NULL) && _shadowRead(memoryAddress, buffer, length, IDPage)) return length;
+  return _readChunked(memoryAddress, buffer, length, IDPage);
+}
+
+
+//  returns bytes read.
+uint16_t I2C_eeprom::readBlockUncached(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage)
+{
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_READBLOCK);
+  return _readChunked(memoryAddress, buffer, length, IDPage);
 }
 
 
 //  returns true or false.
 bool I2C_eeprom::verifyBlock(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_VERIFYBLOCK);
   uint16_t addr = memoryAddress;
   uint16_t len = length;
   while (len > 0)
@@ -225,6 +281,7 @@ bool I2C_eeprom::verifyBlock(const uint16_t memoryAddress, const uint8_t * buffe
 //  returns 0 == OK
 int I2C_eeprom::updateByte(const uint16_t memoryAddress, const uint8_t data, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_UPDATEBYTE);
   if (data == readByte(memoryAddress, IDPage)) return 0;
   return writeByte(memoryAddress, data, IDPage);
 }
@@ -233,6 +290,7 @@ int I2C_eeprom::updateByte(const uint16_t memoryAddress, const uint8_t data, boo
 //  returns bytes written.
 uint16_t I2C_eeprom::updateBlock(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_UPDATEBLOCK);
   uint16_t addr = memoryAddress;
   uint16_t len = length;
   uint16_t rv = 0;
@@ -263,7 +321,7 @@ uint16_t I2C_eeprom::updateBlock(const uint16_t memoryAddress, const uint8_t * b
         // Serial.print("Atarting Diff Address: ");
         // Serial.println(startDiffAddr, DEC);
         rv += diffCount;
-        _pageBlock(startDiffAddr, &buffer[startDiffAddr], diffCount, true, IDPage);
+        _pageBlock(startDiffAddr, &buffer[startDiffAddr - addr], diffCount, true, IDPage);
         diffCount = 0; // Reset difference count after writing.
         writeCnt++;
       }
@@ -282,7 +340,7 @@ uint16_t I2C_eeprom::updateBlock(const uint16_t memoryAddress, const uint8_t * b
       uint16_t cnt = I2C_BUFFERSIZE;
 
       if (cnt > len) cnt = len;
-      _ReadBlock(addr, buf, cnt);
+      _ReadBlock(addr, buf, cnt, IDPage);
       if (memcmp(buffer, buf, cnt) != 0)
       {
         rv   += cnt; // update rv to actual number of bytes written due to failed compare
@@ -305,8 +363,11 @@ uint16_t I2C_eeprom::updateBlock(const uint16_t memoryAddress, const uint8_t * b
 //  return false if write or verify failed.
 bool I2C_eeprom::writeByteVerify(const uint16_t memoryAddress, const uint8_t value, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_WRITEBYTEVERIFY);
   if (writeByte(memoryAddress, value, IDPage) != 0 ) return false;
-  uint8_t data = readByte(memoryAddress, IDPage);
+  //  from the device, not the read shadow.
+  uint8_t data;
+  if (_ReadBlock(memoryAddress, &data, 1, IDPage) != 1) return false;
   return (data == value);
 }
 
@@ -314,6 +375,7 @@ bool I2C_eeprom::writeByteVerify(const uint16_t memoryAddress, const uint8_t val
 //  return false if write or verify failed.
 bool I2C_eeprom::writeBlockVerify(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_WRITEBLOCKVERIFY);
   if (writeBlock(memoryAddress, buffer, length, IDPage) != 0) return false;
   return verifyBlock(memoryAddress, buffer, length, IDPage);
 }
@@ -322,10 +384,15 @@ bool I2C_eeprom::writeBlockVerify(const uint16_t memoryAddress, const uint8_t *
 //  return false if write or verify failed.
 bool I2C_eeprom::setBlockVerify(const uint16_t memoryAddress, const uint8_t value, const uint16_t length, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_SETBLOCKVERIFY);
   if (setBlock(memoryAddress, value, length, IDPage) != 0) return false;
   uint8_t * data = (uint8_t *) malloc(length);
   if (data == NULL) return false;
-  if (readBlock(memoryAddress, data, length) != length) return false;
+  if (readBlockUncached(memoryAddress, data, length, IDPage) != length)
+  {
+    free(data);
+    return false;
+  }
   for (uint16_t i = 0; i < length; i++)
   {
     if (data[i] != value)
@@ -342,8 +409,11 @@ bool I2C_eeprom::setBlockVerify(const uint16_t memoryAddress, const uint8_t valu
 //  return false if write or verify failed.
 bool I2C_eeprom::updateByteVerify(const uint16_t memoryAddress, const uint8_t value, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_UPDATEBYTEVERIFY);
   if (updateByte(memoryAddress, value, IDPage) != 0 ) return false;
-  uint8_t data = readByte(memoryAddress, IDPage);
+  //  from the device, not the read shadow.
+  uint8_t data;
+  if (_ReadBlock(memoryAddress, &data, 1, IDPage) != 1) return false;
   return (data == value);
 }
 
@@ -351,11 +421,47 @@ bool I2C_eeprom::updateByteVerify(const uint16_t memoryAddress, const uint8_t va
 //  return false if write or verify failed.
 bool I2C_eeprom::updateBlockVerify(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage)
 {
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_UPDATEBLOCKVERIFY);
   if (updateBlock(memoryAddress, buffer, length, IDPage) != length) return false;
   return verifyBlock(memoryAddress, buffer, length, IDPage);
 }
 
 
+/////////////////////////////////////////////////////////////
+//
+//  COPY SECTION
+//
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom::copy(const uint16_t src, const uint16_t dst, const uint16_t length)
+{
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_COPY);
+  return _copy(*this, src, dst, length);
+}
+
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom::copy(I2C_eeprom & target, const uint16_t src, const uint16_t dst, const uint16_t length)
+{
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_COPY);
+  return _copy(target, src, dst, length);
+}
+
+
+//  returns I2C status, 0 = OK
+int I2C_eeprom::move(const uint16_t src, const uint16_t dst, const uint16_t length, const uint8_t fill)
+{
+  I2C_EEPROM_OP_SCOPE(I2C_EEPROM_OP_MOVE);
+  int rv = _copy(*this, src, dst, length);
+  if ((rv != 0) || (src == dst)) return rv;
+
+  //  fill the source bytes not covered by the destination.
+  if ((dst > src) && (dst < src + length)) return setBlock(src, fill, dst - src);
+  if ((src > dst) && (src < dst + length)) return setBlock(dst + length, fill, src - dst);
+  return setBlock(src, fill, length);
+}
+
+
 /////////////////////////////////////////////////////////////
 //
 //  METADATA SECTION
@@ -531,6 +637,20 @@ uint32_t I2C_eeprom::getLastWrite()
 }
 
 
+bool I2C_eeprom::isReady()
+{
+  uint32_t waitTime = I2C_WRITEDELAY + _extraTWR * 1000UL;
+  if ((micros() - _lastWrite) > waitTime) return true;
+  return isConnected();
+}
+
+
+TwoWire * I2C_eeprom::getWire()
+{
+  return _wire;
+}
+
+
 uint32_t I2C_eeprom::setDeviceSize(uint32_t deviceSize)
 {
   uint32_t size = 128;
@@ -629,6 +749,432 @@ bool I2C_eeprom::getPerByteCompare()
 {
   return _perByteCompare;
 }
+
+
+/////////////////////////////////////////////////////////////
+//
+//  ERROR RECOVERY SECTION
+//
+void I2C_eeprom::setRetryPolicy(uint8_t retries, uint16_t backoff, uint16_t maxBackoff)
+{
+  _retries = retries;
+  _backoff = backoff;
+  _maxBackoff = (maxBackoff < backoff) ? backoff : maxBackoff;
+}
+
+
+uint8_t I2C_eeprom::getRetries()
+{
+  return _retries;
+}
+
+
+void I2C_eeprom::setBusRecoveryPins(int8_t sda, int8_t scl)
+{
+  _sdaPin = sda;
+  _sclPin = scl;
+}
+
+
+//  SDA and SCL are driven open drain, LOW = output low, HIGH = input pull up.
+bool I2C_eeprom::recoverBus()
+{
+  if ((_sdaPin < 0) || (_sclPin < 0)) return false;
+  _recoveryCount++;
+
+  pinMode(_sdaPin, INPUT_PULLUP);
+  pinMode(_sclPin, INPUT_PULLUP);
+  //  clock out the byte a device may still be sending.
+  for (uint8_t i = 0; (i < 9) && (digitalRead(_sdaPin) == LOW); i++)
+  {
+    pinMode(_sclPin, OUTPUT);
+    digitalWrite(_sclPin, LOW);
+    delayMicroseconds(5);
+    pinMode(_sclPin, INPUT_PULLUP);
+    delayMicroseconds(5);
+  }
+  //  STOP = SDA low to high while SCL is high.
+  pinMode(_sdaPin, OUTPUT);
+  digitalWrite(_sdaPin, LOW);
+  delayMicroseconds(5);
+  pinMode(_sdaPin, INPUT_PULLUP);
+  delayMicroseconds(5);
+  bool released = (digitalRead(_sdaPin) == HIGH);
+
+  _wire->begin();
+  //  the clock under test during calibrate(), not the last good one.
+  if (_busClock > 0) _wire->setClock(_busClock);
+  return released;
+}
+
+
+int I2C_eeprom::getLastError()
+{
+  return _lastError;
+}
+
+
+uint16_t I2C_eeprom::getLastErrorAddress()
+{
+  return _lastErrorAddress;
+}
+
+
+uint8_t I2C_eeprom::getLastRetries()
+{
+  return _lastRetries;
+}
+
+
+uint32_t I2C_eeprom::getRetryCount()
+{
+  return _retryCount;
+}
+
+
+uint32_t I2C_eeprom::getRecoveryCount()
+{
+  return _recoveryCount;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  CLOCK CALIBRATION SECTION
+//
+uint32_t I2C_eeprom::calibrate(uint32_t maxClock, int32_t scratchAddress)
+{
+  const uint32_t clocks[3] = { 100000, 400000, 1000000 };
+  _lastError = 0;
+  if (maxClock < clocks[0])
+  {
+    _failed(12, 0);  //  out of range
+    return 0;
+  }
+  uint8_t reference[I2C_EEPROM_CALIBRATE_SIZE];
+  uint16_t length = I2C_EEPROM_CALIBRATE_SIZE;
+  if (length > _deviceSize) length = _deviceSize;
+  uint16_t address = (scratchAddress >= 0) ? scratchAddress : 0;
+
+  //  reference data at the standard clock.
+  _clock = 0;
+  _bytesPerSecond = 0;
+  _setClock(clocks[0]);
+  //  probes read the device, never the read shadow.
+  if (readBlockUncached(address, reference, length) != length) return 0;
+
+  //  a retry would hide the marginal errors the probes look for.
+  uint8_t retries = _retries;
+  _retries = 0;
+  uint32_t best = 0;
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    uint32_t clock = clocks[i];
+    if (clock > maxClock)
+    {
+      //  last step at maxClock itself, e.g. 800 kHz.
+      if ((i == 0) || (clocks[i - 1] >= maxClock)) break;
+      clock = maxClock;
+    }
+    if (! _probeClock(clock, reference, length, scratchAddress)) break;
+    best = clock;
+  }
+  _retries = retries;
+
+  //  back off to the fastest stable clock.
+  _setClock((best == 0) ? clocks[0] : best);
+  if (best == 0) _bytesPerSecond = 0;
+  if (scratchAddress >= 0)
+  {
+    //  a failed probe may have left its pattern behind.
+    if (! verifyBlock(address, reference, length)) writeBlock(address, reference, length);
+  }
+  _clock = best;
+  return best;
+}
+
+
+uint32_t I2C_eeprom::getClock()
+{
+  return _clock;
+}
+
+
+uint32_t I2C_eeprom::getBytesPerSecond()
+{
+  return _bytesPerSecond;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  READ SHADOW SECTION
+//
+
+//  Entry layout in the buffer
+//   0  page number     uint16_t
+//   2  flags           bit 0 = in use, bit 1 = ID page
+//   3  reserved
+//   4  page data       _pageSize bytes
+//      valid mask      1 bit per data byte
+bool I2C_eeprom::enableReadShadow(uint8_t * buffer, uint16_t size)
+{
+  uint16_t pages = size / I2C_EEPROM_SHADOW_ENTRY(_pageSize);
+  if ((buffer == NULL) || (pages == 0)) return false;
+  _shadow = buffer;
+  _shadowPages = (pages > 255) ? 255 : pages;
+  clearReadShadow();
+  return true;
+}
+
+
+void I2C_eeprom::disableReadShadow()
+{
+  _shadow = NULL;
+  _shadowPages = 0;
+}
+
+
+void I2C_eeprom::clearReadShadow()
+{
+  for (uint8_t i = 0; i < _shadowPages; i++)
+  {
+    _shadow[i * I2C_EEPROM_SHADOW_ENTRY(_pageSize) + 2] = 0;
+  }
+  _shadowNext = 0;
+}
+
+
+uint8_t I2C_eeprom::getShadowPages()
+{
+  return _shadowPages;
+}
+
+
+uint32_t I2C_eeprom::getShadowHits()
+{
+  return _shadowHits;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  TRACING SECTION
+//
+void I2C_eeprom::setTracer(I2C_eeprom_tracer * tracer)
+{
+  _tracer = tracer;
+}
+
+
+I2C_eeprom_tracer * I2C_eeprom::getTracer()
+{
+  return _tracer;
+}
+
+
+/////////////////////////////////////////////////////////////
+//
+//  WEAR TRACKING SECTION
+//
+
+//  counters must hold pages entries, pages beyond the array are not counted.
+bool I2C_eeprom::enableWearTracking(uint16_t * counters, uint16_t pages)
+{
+  if ((counters == NULL) || (pages == 0)) return false;
+  _wearCounters = counters;
+  _wearPages = pages;
+  resetWearTracking();
+  return true;
+}
+
+
+void I2C_eeprom::disableWearTracking()
+{
+  _wearCounters = NULL;
+  _wearPages = 0;
+}
+
+
+void I2C_eeprom::resetWearTracking()
+{
+  for (uint16_t i = 0; i < _wearPages; i++)
+  {
+    _wearCounters[i] = 0;
+  }
+  _idPageWrites = 0;
+  _totalWrites = 0;
+}
+
+
+uint16_t I2C_eeprom::getWearPages()
+{
+  return _wearPages;
+}
+
+
+uint16_t I2C_eeprom::getPageWrites(uint16_t page)
+{
+  if (page >= _wearPages) return 0;
+  return _wearCounters[page];
+}
+
+
+uint16_t I2C_eeprom::getIDPageWrites()
+{
+  return _idPageWrites;
+}
+
+
+uint32_t I2C_eeprom::getTotalPageWrites()
+{
+  return _totalWrites;
+}
+
+
+uint16_t I2C_eeprom::getHottestPage()
+{
+  uint16_t hottest = 0;
+  for (uint16_t i = 1; i < _wearPages; i++)
+  {
+    if (_wearCounters[i] > _wearCounters[hottest]) hottest = i;
+  }
+  return hottest;
+}
+
+
+//  returns pages per cell, 0 if tracking is not enabled.
+uint16_t I2C_eeprom::getHeatmap(uint8_t * cells, const uint16_t count)
+{
+  if ((_wearPages == 0) || (count == 0)) return 0;
+  uint16_t perCell = (_wearPages + count - 1) / count;
+  uint32_t hottest = _wearCounters[getHottestPage()];
+
+  for (uint16_t c = 0; c < count; c++)
+  {
+    uint16_t peak = 0;
+    for (uint16_t i = c * perCell; (i < (c + 1) * perCell) && (i < _wearPages); i++)
+    {
+      if (_wearCounters[i] > peak) peak = _wearCounters[i];
+    }
+    //  round up so any written page shows up in the map.
+    cells[c] = (hottest == 0) ? 0 : (peak * 255UL + hottest - 1) / hottest;
+  }
+  return perCell;
+}
+
+
+uint32_t I2C_eeprom::getWearRemaining(const uint32_t endurance)
+{
+  uint32_t worst = getPageWrites(getHottestPage());
+  if (worst >= endurance) return 0;
+  return endurance - worst;
+}
+
+
+//  returns 0xFFFFFFFF if nothing is written yet.
+uint32_t I2C_eeprom::getWearProjection(const uint32_t elapsed, const uint32_t endurance)
+{
+  uint32_t worst = getPageWrites(getHottestPage());
+  if (worst == 0) return 0xFFFFFFFF;
+  uint64_t projection = (uint64_t)elapsed * getWearRemaining(endurance) / worst;
+  if (projection > 0xFFFFFFFF) return 0xFFFFFFFF;
+  return projection;
+}
+
+
+//  Summary layout, little endian
+//   0  'W'             magic
+//   1  1               version
+//   2  pages           uint16_t
+//   4  total writes    uint32_t
+//   8  hottest page    uint16_t
+//  10  hottest count   uint16_t
+//  12  ID page writes  uint16_t
+//  14  group shift     pages per nibble = 1 << shift
+//  15  reserved
+//  16  nibbles, log2 bucket of the busiest page in each group,
+//      0 = never written, n = [2^(n-1) .. 2^n), 15 = 16384 or more.
+int I2C_eeprom::saveWearSummary(const uint16_t memoryAddress, const uint16_t length, bool IDPage)
+{
+  if ((_wearPages == 0) || (length <= I2C_EEPROM_WEAR_HEADER)) return 12;
+
+  //  pick the smallest grouping that fits in the given length.
+  uint8_t shift = 0;
+  while ((((_wearPages >> shift) + 2) / 2 + I2C_EEPROM_WEAR_HEADER) > length) shift++;
+  uint16_t groups = (_wearPages + (1 << shift) - 1) >> shift;
+  uint16_t size = I2C_EEPROM_WEAR_HEADER + (groups + 1) / 2;
+
+  uint8_t * summary = (uint8_t *) malloc(size);
+  if (summary == NULL) return 12;
+  memset(summary, 0, size);
+
+  uint16_t hottest = getHottestPage();
+  uint16_t values[6] = { _wearPages, (uint16_t)_totalWrites, (uint16_t)(_totalWrites >> 16),
+                         hottest, _wearCounters[hottest], _idPageWrites };
+  summary[0] = 'W';
+  summary[1] = 1;
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    summary[2 + i * 2] = values[i] & 0xFF;
+    summary[3 + i * 2] = values[i] >> 8;
+  }
+  summary[14] = shift;
+
+  for (uint16_t g = 0; g < groups; g++)
+  {
+    uint16_t peak = 0;
+    for (uint16_t i = g << shift; (i < (uint16_t)((g + 1) << shift)) && (i < _wearPages); i++)
+    {
+      if (_wearCounters[i] > peak) peak = _wearCounters[i];
+    }
+    uint8_t bucket = 0;
+    while ((peak >> bucket) && (bucket < 15)) bucket++;
+    summary[I2C_EEPROM_WEAR_HEADER + g / 2] |= (g & 1) ? (bucket << 4) : bucket;
+  }
+
+  int rv = writeBlock(memoryAddress, summary, size, IDPage);
+  free(summary);
+  return rv;
+}
+
+
+bool I2C_eeprom::loadWearSummary(const uint16_t memoryAddress, const uint16_t length, bool IDPage)
+{
+  if ((_wearPages == 0) || (length <= I2C_EEPROM_WEAR_HEADER)) return false;
+
+  uint8_t header[I2C_EEPROM_WEAR_HEADER];
+  if (readBlock(memoryAddress, header, I2C_EEPROM_WEAR_HEADER, IDPage) != I2C_EEPROM_WEAR_HEADER) return false;
+  uint16_t pages = header[2] | (header[3] << 8);
+  uint8_t shift = header[14];
+  if ((header[0] != 'W') || (header[1] != 1) || (pages != _wearPages) || (shift > 15)) return false;
+
+  uint16_t groups = (pages + (1 << shift) - 1) >> shift;
+  uint16_t size = (groups + 1) / 2;
+  if (size + I2C_EEPROM_WEAR_HEADER > length) return false;
+
+  uint8_t * nibbles = (uint8_t *) malloc(size);
+  if (nibbles == NULL) return false;
+  if (readBlock(memoryAddress + I2C_EEPROM_WEAR_HEADER, nibbles, size, IDPage) != size)
+  {
+    free(nibbles);
+    return false;
+  }
+
+  for (uint16_t i = 0; i < _wearPages; i++)
+  {
+    uint16_t g = i >> shift;
+    uint8_t bucket = (g & 1) ? (nibbles[g / 2] >> 4) : (nibbles[g / 2] & 0x0F);
+    _wearCounters[i] = (bucket == 0) ? 0 : (1U << (bucket - 1));
+  }
+  free(nibbles);
+
+  uint16_t hottest = header[8] | (header[9] << 8);
+  if (hottest < _wearPages) _wearCounters[hottest] = header[10] | (header[11] << 8);
+  _totalWrites  = header[4] | (header[5] << 8) | ((uint32_t)header[6] << 16) | ((uint32_t)header[7] << 24);
+  _idPageWrites = header[12] | (header[13] << 8);
+  return true;
+}
   
 
 ////////////////////////////////////////////////////////////////////
@@ -673,6 +1219,48 @@ int I2C_eeprom::_pageBlock(const uint16_t memoryAddress, const uint8_t * buffer,
 }
 
 
+//  works on page sized chunks of the destination, backwards when the
+//  destination overlaps the end of the source on the same device.
+//  returns 0 = OK otherwise error
+int I2C_eeprom::_copy(I2C_eeprom & target, const uint16_t src, const uint16_t dst, const uint16_t length)
+{
+  if (((uint32_t)src + length > _deviceSize) || ((uint32_t)dst + length > target._deviceSize))
+  {
+    return 12;  //  beyond the EEPROM's memory limits, see _pageBlock()
+  }
+  if ((&target == this) && (src == dst)) return 0;
+
+  uint8_t buffer[I2C_BUFFERSIZE];
+  bool backwards = (&target == this) && (dst > src) && (dst < src + length);
+  uint16_t len = length;
+  while (len > 0)
+  {
+    uint16_t cnt = I2C_BUFFERSIZE;
+    if (cnt > len) cnt = len;
+    //  keep the chunk within one destination page.
+    uint16_t offset;
+    if (backwards)
+    {
+      uint16_t room = (dst + len - 1) % target._pageSize + 1;
+      if (cnt > room) cnt = room;
+      offset = len - cnt;
+    }
+    else
+    {
+      offset = length - len;
+      uint16_t room = target._pageSize - (dst + offset) % target._pageSize;
+      if (cnt > room) cnt = room;
+    }
+
+    if (readBlock(src + offset, buffer, cnt) != cnt) return 14;  //  read failed
+    int rv = target._WriteBlock(dst + offset, buffer, cnt);
+    if (rv != 0) return rv;
+    len -= cnt;
+  }
+  return 0;
+}
+
+
 //  supports one and two bytes addresses
 void I2C_eeprom::_beginTransmission(const uint16_t memoryAddress, bool IDPage)
 {
@@ -698,22 +1286,37 @@ void I2C_eeprom::_beginTransmission(const uint16_t memoryAddress, bool IDPage)
 //  returns 0 = OK otherwise error
 int I2C_eeprom::_WriteBlock(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage)
 {
-  _waitEEReady(IDPage);
-  if (_autoWriteProtect)
+  int rv = 0;
+  uint16_t backoff = _backoff;
+  for (uint8_t attempt = 0; ; attempt++)
   {
-    digitalWrite(_writeProtectPin, LOW);
-  }
+    _waitEEReady(IDPage);
+    uint32_t start = I2C_EEPROM_TRACE_START;
+    if (_autoWriteProtect)
+    {
+      digitalWrite(_writeProtectPin, LOW);
+    }
 
-  this->_beginTransmission(memoryAddress, IDPage);
-  _wire->write(buffer, length);
-  int rv = _wire->endTransmission();
+    this->_beginTransmission(memoryAddress, IDPage);
+    _wire->write(buffer, length);
+    rv = _wire->endTransmission();
 
-  if (_autoWriteProtect)
-  {
-    digitalWrite(_writeProtectPin, HIGH);
+    if (_autoWriteProtect)
+    {
+      digitalWrite(_writeProtectPin, HIGH);
+    }
+
+    _lastWrite = micros();
+    I2C_EEPROM_TRACE_EVENT(I2C_EEPROM_TRACE_WRITE, memoryAddress, length, rv, start);
+
+    if ((rv == 0) || (attempt >= _retries)) break;
+    //  re-issue this page chunk only.
+    _retryWait(rv, memoryAddress, backoff);
   }
-  
-  _lastWrite = micros();
+
+  if (rv != 0) _failed(rv, memoryAddress);
+  if ((rv == 0) && (_wearCounters != NULL)) _countWear(memoryAddress, IDPage);
+  if (_shadow != NULL) _shadowWrite(memoryAddress, buffer, length, IDPage, rv);
 
   yield();     // For OS scheduling
 
@@ -732,37 +1335,34 @@ int I2C_eeprom::_WriteBlock(const uint16_t memoryAddress, const uint8_t * buffer
 }
 
 
-//  pre: buffer is large enough to hold length bytes
-//  returns bytes read
-uint16_t I2C_eeprom::_ReadBlock(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage)
+//  returns bytes read.
+//  split in I2C_BUFFERSIZE transactions, shared by readBlock() and
+//  readBlockUncached() so a read is one operation for the tracer.
+uint16_t I2C_eeprom::_readChunked(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage)
 {
-  _waitEEReady(IDPage);
-
-  this->_beginTransmission(memoryAddress, IDPage);
-  int rv = _wire->endTransmission(false);
-  if (rv != 0)
+  uint16_t addr = memoryAddress;
+  uint16_t len = length;
+  uint16_t rv = 0;
+  while (len > 0)
   {
-//    if (_debug)
-//    {
-//      SPRN("mem addr r: ");
-//      SPRNH(memoryAddress, HEX);
-//      SPRN("\t");
-//      SPRNL(rv);
-//    }
-    return 0;  //  error
+    uint16_t cnt = I2C_BUFFERSIZE;
+    if (cnt > len) cnt = len;
+    rv     += _ReadBlock(addr, buffer, cnt, IDPage);
+    addr   += cnt;
+    buffer += cnt;
+    len    -= cnt;
   }
+  _wire->endTransmission();
+  return rv;
+}
+
 
+//  pre: buffer is large enough to hold length bytes
+//  returns bytes read
+uint16_t I2C_eeprom::_ReadBlock(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage)
+{
   //  readBytes will always be equal or smaller to length
-  uint16_t readBytes = 0;
-  if (this->_isAddressSizeTwoWords)
-  {
-    readBytes = _wire->requestFrom(((IDPage && _hasIDPage) ? _idPageDeviceAddress : _deviceAddress), length);
-  }
-  else
-  {
-    uint8_t addr = ((IDPage && _hasIDPage) ? _idPageDeviceAddress : _deviceAddress) | ((memoryAddress >> 8) & 0x07);
-    readBytes = _wire->requestFrom(addr, length);
-  }
+  uint16_t readBytes = _requestBlock(memoryAddress, length, IDPage);
   yield();     //  For OS scheduling
   uint16_t cnt = 0;
   while (cnt < readBytes)
@@ -777,61 +1377,226 @@ uint16_t I2C_eeprom::_ReadBlock(const uint16_t memoryAddress, uint8_t * buffer,
 //  returns true if equal.
 bool I2C_eeprom::_verifyBlock(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage)
 {
-  _waitEEReady(IDPage);
+  uint16_t readBytes = _requestBlock(memoryAddress, length, IDPage);
+  if (readBytes != length) return false;  //  error
+  yield();     //  For OS scheduling
+  uint8_t cnt = 0;
+  while (cnt < readBytes)
+  {
+    if (buffer[cnt++] != _wire->read())
+    {
+      return false;
+    }
+  }
+  return true;
+}
 
-  this->_beginTransmission(memoryAddress, IDPage);
-  int rv = _wire->endTransmission(false);
-  if (rv != 0)
+
+//  returns number of bytes available in the Wire buffer,
+//  length if OK, less after all retries failed.
+uint16_t I2C_eeprom::_requestBlock(const uint16_t memoryAddress, const uint16_t length, bool IDPage)
+{
+  uint16_t readBytes = 0;
+  uint16_t backoff = _backoff;
+  for (uint8_t attempt = 0; ; attempt++)
   {
-//    if (_debug)
-//    {
-//      SPRN("mem addr r: ");
-//      SPRNH(memoryAddress, HEX);
-//      SPRN("\t");
-//      SPRNL(rv);
-//    }
-    return false;  //  error
+    _waitEEReady(IDPage);
+    uint32_t start = I2C_EEPROM_TRACE_START;
+
+    this->_beginTransmission(memoryAddress, IDPage);
+    int rv = _wire->endTransmission(false);
+    readBytes = 0;
+    if (rv == 0)
+    {
+      if (this->_isAddressSizeTwoWords)
+      {
+        readBytes = _wire->requestFrom(((IDPage && _hasIDPage) ? _idPageDeviceAddress : _deviceAddress), length);
+      }
+      else
+      {
+        uint8_t addr = ((IDPage && _hasIDPage) ? _idPageDeviceAddress : _deviceAddress) | ((memoryAddress >> 8) & 0x07);
+        readBytes = _wire->requestFrom(addr, length);
+      }
+      //  a short read is reported as other error.
+      if (readBytes != length) rv = 4;
+    }
+    I2C_EEPROM_TRACE_EVENT(I2C_EEPROM_TRACE_READ, memoryAddress, length, rv, start);
+
+    if (rv == 0) return readBytes;
+    if (attempt >= _retries)
+    {
+      _failed(rv, memoryAddress);
+      return readBytes;
+    }
+    _retryWait(rv, memoryAddress, backoff);
   }
+}
 
-  //  readBytes will always be equal or smaller to length
-  uint8_t readBytes = 0;
-  if (this->_isAddressSizeTwoWords)
+
+//  counts the retry, recovers the bus on bus errors, then waits backoff.
+void I2C_eeprom::_retryWait(const int rv, const uint16_t memoryAddress, uint16_t & backoff)
+{
+  _lastRetries++;
+  _retryCount++;
+  uint32_t start = I2C_EEPROM_TRACE_START;
+  //  2 / 3 == NACK, the device is busy or glitched, otherwise the bus is suspect.
+  if ((rv >= 4) && (_sdaPin >= 0)) recoverBus();
+  delayMicroseconds(backoff);
+  I2C_EEPROM_TRACE_EVENT(I2C_EEPROM_TRACE_RETRY, memoryAddress, 0, rv, start);
+  backoff = (backoff > _maxBackoff / 2) ? _maxBackoff : backoff * 2;
+}
+
+
+void I2C_eeprom::_failed(const int rv, const uint16_t memoryAddress)
+{
+  _lastError = rv;
+  _lastErrorAddress = memoryAddress;
+}
+
+
+void I2C_eeprom::_setClock(const uint32_t clock)
+{
+  _busClock = clock;
+  _wire->setClock(clock);
+}
+
+
+//  runs I2C_EEPROM_CALIBRATE_ROUNDS read probes at clock,
+//  and a write / verify / restore of the scratch area if given.
+//  on success _clock and _bytesPerSecond hold the measurement.
+bool I2C_eeprom::_probeClock(uint32_t clock, const uint8_t * reference, uint16_t length, int32_t scratchAddress)
+{
+  uint8_t buffer[I2C_EEPROM_CALIBRATE_SIZE];
+  uint16_t address = (scratchAddress >= 0) ? scratchAddress : 0;
+  _setClock(clock);
+
+  uint32_t start = micros();
+  for (uint8_t r = 0; r < I2C_EEPROM_CALIBRATE_ROUNDS; r++)
   {
-    readBytes = _wire->requestFrom(((IDPage && _hasIDPage) ? _idPageDeviceAddress : _deviceAddress), length);
+    if (readBlockUncached(address, buffer, length) != length) return false;
+    if (memcmp(buffer, reference, length) != 0) return false;
   }
-  else
+  uint32_t duration = micros() - start;
+
+  if (scratchAddress >= 0)
   {
-    uint8_t addr = ((IDPage && _hasIDPage) ? _idPageDeviceAddress : _deviceAddress) | ((memoryAddress >> 8) & 0x07);
-    readBytes = _wire->requestFrom(addr, length);
+    for (uint16_t i = 0; i < length; i++) buffer[i] = ~reference[i];
+    if (writeBlock(address, buffer, length) != 0) return false;
+    if (! verifyBlock(address, buffer, length)) return false;
+    if (writeBlock(address, reference, length) != 0) return false;
+    if (! verifyBlock(address, reference, length)) return false;
   }
-  yield();     //  For OS scheduling
-  uint8_t cnt = 0;
-  while (cnt < readBytes)
+
+  if (duration == 0) duration = 1;
+  _clock = clock;
+  _bytesPerSecond = (uint64_t)length * I2C_EEPROM_CALIBRATE_ROUNDS * 1000000UL / duration;
+  return true;
+}
+
+
+//  returns the shadow entry of page or NULL if it is not shadowed.
+uint8_t * I2C_eeprom::_shadowEntry(const uint16_t page, bool IDPage)
+{
+  uint8_t flags = (IDPage && _hasIDPage) ? 0x03 : 0x01;
+  for (uint8_t i = 0; i < _shadowPages; i++)
   {
-    if (buffer[cnt++] != _wire->read())
-    {
-      return false;
-    }
+    uint8_t * entry = _shadow + i * I2C_EEPROM_SHADOW_ENTRY(_pageSize);
+    if ((entry[2] == flags) && ((entry[0] | (entry[1] << 8)) == page)) return entry;
   }
+  return NULL;
+}
+
+
+//  pre: write does not cross a page boundary (see _pageBlock)
+void I2C_eeprom::_shadowWrite(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage, int rv)
+{
+  uint16_t page = memoryAddress / _pageSize;
+  uint8_t * entry = _shadowEntry(page, IDPage);
+  if (rv != 0)
+  {
+    //  content of the page is unknown after a failed write.
+    if (entry != NULL) entry[2] = 0;
+    return;
+  }
+  if (entry == NULL)
+  {
+    entry = _shadow + _shadowNext * I2C_EEPROM_SHADOW_ENTRY(_pageSize);
+    _shadowNext = (_shadowNext + 1) % _shadowPages;
+    entry[0] = page & 0xFF;
+    entry[1] = page >> 8;
+    entry[2] = (IDPage && _hasIDPage) ? 0x03 : 0x01;
+    memset(entry + 4 + _pageSize, 0, _pageSize / 8);
+  }
+  uint8_t * data = entry + 4;
+  uint8_t * mask = data + _pageSize;
+  uint16_t offset = memoryAddress % _pageSize;
+  for (uint16_t i = 0; i < length; i++, offset++)
+  {
+    data[offset] = buffer[i];
+    mask[offset / 8] |= (1 << (offset % 8));
+  }
+}
+
+
+//  serves the read from the shadow if the device is still busy
+//  and every requested byte is shadowed.
+bool I2C_eeprom::_shadowRead(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage)
+{
+  uint32_t waitTime = I2C_WRITEDELAY + _extraTWR * 1000UL;
+  if ((length == 0) || ((micros() - _lastWrite) > waitTime)) return false;
+
+  uint32_t addr = memoryAddress;
+  for (uint16_t i = 0; i < length; i++, addr++)
+  {
+    uint8_t * entry = _shadowEntry(addr / _pageSize, IDPage);
+    if (entry == NULL) return false;
+    uint16_t offset = addr % _pageSize;
+    if ((entry[4 + _pageSize + offset / 8] & (1 << (offset % 8))) == 0) return false;
+    buffer[i] = entry[4 + offset];
+  }
+  _shadowHits++;
   return true;
 }
 
 
+//  one write transaction == one write cycle of the page.
+void I2C_eeprom::_countWear(const uint16_t memoryAddress, bool IDPage)
+{
+  _totalWrites++;
+  if (IDPage && _hasIDPage)
+  {
+    if (_idPageWrites < 0xFFFF) _idPageWrites++;
+    return;
+  }
+  uint16_t page = memoryAddress / _pageSize;
+  if ((page < _wearPages) && (_wearCounters[page] < 0xFFFF)) _wearCounters[page]++;
+}
+
+
 void I2C_eeprom::_waitEEReady(bool IDPage)
 {
   //  Wait until EEPROM gives ACK again.
   //  this is a bit faster than the hardcoded 5 milliSeconds
   //  TWR = WriteCycleTime
   uint32_t waitTime = I2C_WRITEDELAY + _extraTWR * 1000UL;
+  uint32_t start = I2C_EEPROM_TRACE_START;
+  bool polled = false;
   while ((micros() - _lastWrite) <= waitTime)
   {
-    if (isConnected(IDPage)) return;
+    polled = true;
+    if (isConnected(IDPage))
+    {
+      I2C_EEPROM_TRACE_EVENT(I2C_EEPROM_TRACE_WAIT, 0, 0, 0, start);
+      return;
+    }
     //  TODO remove pre 1.7.4 code
     // _wire->beginTransmission(_deviceAddress);
     // int x = _wire->endTransmission();
     // if (x == 0) return;
     yield();     //  For OS scheduling
   }
+  //  status 1 == no ACK within tWR, no event if there was no wait.
+  if (polled) I2C_EEPROM_TRACE_EVENT(I2C_EEPROM_TRACE_WAIT, 0, 0, 1, start);
   return;
 }
 
@@ -9,6 +9,7 @@
 
 #include "Arduino.h"
 #include "Wire.h"
+#include "I2C_eeprom_trace.h"
 
 #define EN_AUTO_WRITE_PROTECT           1  // IF WP pin is supplied then _autoWriteProtect is enabled by default
 #define HAS_ID_PAGE                     1
@@ -40,6 +41,44 @@
 #define I2C_WRITEDELAY              5000
 #endif
 
+//  Write endurance used for wear projections.
+//  ST M24xxx data sheets give 4 million cycles at 25 C,
+//  1.2 million at 85 C; one million is a conservative default.
+#ifndef I2C_EEPROM_ENDURANCE
+#define I2C_EEPROM_ENDURANCE        1000000UL
+#endif
+
+//  Size of the wear summary header, see saveWearSummary()
+#define I2C_EEPROM_WEAR_HEADER      16
+
+//  default retry policy, see setRetryPolicy()
+#ifndef I2C_EEPROM_RETRIES
+#define I2C_EEPROM_RETRIES          0
+#endif
+#ifndef I2C_EEPROM_RETRY_BACKOFF
+#define I2C_EEPROM_RETRY_BACKOFF    100     //  microseconds, doubles every retry
+#endif
+#ifndef I2C_EEPROM_RETRY_MAX_BACKOFF
+#define I2C_EEPROM_RETRY_MAX_BACKOFF  2000
+#endif
+
+//  bytes per probe and probes per clock step, see calibrate()
+#ifndef I2C_EEPROM_CALIBRATE_SIZE
+#define I2C_EEPROM_CALIBRATE_SIZE   64
+#endif
+#ifndef I2C_EEPROM_CALIBRATE_ROUNDS
+#define I2C_EEPROM_CALIBRATE_ROUNDS 4
+#endif
+
+//  bytes needed per page for the read shadow, see enableReadShadow()
+//  4 bytes tag + page data + 1 valid bit per byte
+#define I2C_EEPROM_SHADOW_ENTRY(pageSize)   (4 + (pageSize) + (pageSize) / 8)
+
+//  ID page lock state, see isIDPageLocked() and getIDPageLockState()
+#define I2C_EEPROM_IDPAGE_UNKNOWN       0
+#define I2C_EEPROM_IDPAGE_UNLOCKED      1
+#define I2C_EEPROM_IDPAGE_LOCKED        2
+
 #ifndef UNIT_TEST_FRIEND
 #define UNIT_TEST_FRIEND
 #endif
@@ -79,7 +118,8 @@ public:
   I2C_eeprom(const uint8_t deviceAddress, const uint32_t deviceSize, bool hasIDPage=false, TwoWire *wire = &Wire);
 
   //  use default I2C pins.
-  bool     begin(int8_t writeProtectPin = -1);
+  //  maxClock > 0 runs calibrate(maxClock, scratchAddress) after connecting.
+  bool     begin(int8_t writeProtectPin = -1, uint32_t maxClock = 0, int32_t scratchAddress = -1);
   bool     isConnected(bool testIDPage = false);
   uint8_t  getAddress(bool IDPage = false);
 
@@ -100,6 +140,9 @@ public:
   //  reads length bytes into buffer
   //  returns bytes read.
   uint16_t readBlock(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage = false);
+  //  like readBlock() but always from the device, never from the read shadow,
+  //  for read back verification.
+  uint16_t readBlockUncached(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage = false);
   bool     verifyBlock(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage = false);
 
   //  updates a byte at memoryAddress, writes only if there is a new value.
@@ -123,6 +166,18 @@ public:
   bool     updateBlockVerify(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage = false);
 
 
+  //  copies length bytes from src to dst, overlapping ranges are handled
+  //  like memmove. streams through a small buffer in chunks that never
+  //  cross a destination page.
+  //  returns I2C status, 0 = OK
+  int      copy(const uint16_t src, const uint16_t dst, const uint16_t length);
+  //  copies to another device, the next source chunk is read while the
+  //  target is in its write cycle.
+  int      copy(I2C_eeprom & target, const uint16_t src, const uint16_t dst, const uint16_t length);
+  //  copy() and fill the part of the source that is not overwritten.
+  int      move(const uint16_t src, const uint16_t dst, const uint16_t length, const uint8_t fill = 0xFF);
+
+
   //  Meta data functions
   uint32_t determineSize(const bool debug = false);
   uint32_t determineSizeNoWrite();
@@ -130,6 +185,9 @@ public:
   uint8_t  getPageSize();
   uint8_t  getPageSize(uint32_t deviceSize);
   uint32_t getLastWrite();
+  //  non blocking, true if the write cycle of the last write has ended.
+  bool     isReady();
+  TwoWire * getWire();
 
 
   //  for overruling and debugging.
@@ -154,14 +212,107 @@ public:
   bool     getAutoWriteProtect();
 
 
+  //  WEAR TRACKING
+  //  counts write cycles per physical page in a RAM array supplied by
+  //  the caller, one uint16_t per page (counters saturate at 0xFFFF).
+  //  counting adds no I2C traffic, only saveWearSummary() touches the bus.
+  bool     enableWearTracking(uint16_t * counters, uint16_t pages);
+  void     disableWearTracking();
+  void     resetWearTracking();
+  uint16_t getWearPages();
+  uint16_t getPageWrites(uint16_t page);
+  uint16_t getIDPageWrites();
+  uint32_t getTotalPageWrites();
+  //  returns the page with the most write cycles.
+  uint16_t getHottestPage();
+  //  fills cells[] with a heatmap, every cell covers an equal group of pages,
+  //  value 0..255 relative to the hottest page. returns pages per cell.
+  uint16_t getHeatmap(uint8_t * cells, const uint16_t count);
+  //  write cycles left for the hottest page.
+  uint32_t getWearRemaining(const uint32_t endurance = I2C_EEPROM_ENDURANCE);
+  //  extrapolates the time until the hottest page reaches endurance,
+  //  elapsed = time in which the counted writes happened, result in same unit.
+  uint32_t getWearProjection(const uint32_t elapsed, const uint32_t endurance = I2C_EEPROM_ENDURANCE);
+  //  checkpoint a compressed summary (header + 4 bit log2 bucket per page group)
+  //  in length bytes at memoryAddress, e.g. a reserved area or the ID page.
+  //  returns I2C status, 0 = OK
+  int      saveWearSummary(const uint16_t memoryAddress, const uint16_t length, bool IDPage = false);
+  //  restores the counters from a summary, grouped pages get the lower bound
+  //  of their bucket. returns false if no valid summary is found.
+  bool     loadWearSummary(const uint16_t memoryAddress, const uint16_t length, bool IDPage = false);
+
+
+  //  ERROR RECOVERY
+  //  a failed write or read transaction is re-issued up to retries times,
+  //  only the failed page chunk, after a backoff that doubles up to maxBackoff.
+  //  worst case per transaction: (retries + 1) x (tWR + transfer) + sum of backoffs.
+  //  on status >= 4 (bus error, arbitration lost, timeout) the bus is first
+  //  recovered if setBusRecoveryPins() is called.
+  void     setRetryPolicy(uint8_t retries, uint16_t backoff = I2C_EEPROM_RETRY_BACKOFF,
+                          uint16_t maxBackoff = I2C_EEPROM_RETRY_MAX_BACKOFF);
+  uint8_t  getRetries();
+  void     setBusRecoveryPins(int8_t sda, int8_t scl);
+  //  up to 9 SCL pulses until SDA is released, a STOP, then restarts Wire.
+  //  returns true if SDA is high afterwards.
+  bool     recoverBus();
+  //  report of the last public operation (incl. nested calls)
+  //  I2C status of the last transaction that failed after all retries, 0 = OK
+  int      getLastError();
+  uint16_t getLastErrorAddress();
+  uint8_t  getLastRetries();
+  //  totals
+  uint32_t getRetryCount();
+  uint32_t getRecoveryCount();
+
+
+  //  CLOCK CALIBRATION
+  //  steps the bus clock up 100 kHz, 400 kHz, 1 MHz (max maxClock),
+  //  probes the device at every step and backs off to the fastest clock
+  //  that passed. the probes only read, unless scratchAddress >= 0, then
+  //  that area is also written, verified and restored.
+  //  note: the clock is set for the whole bus.
+  //  returns the selected clock, 0 if the device fails at 100 kHz.
+  //  maxClock < 100 kHz is rejected: returns 0 with getLastError() == 12
+  //  and leaves the bus clock as is.
+  uint32_t calibrate(uint32_t maxClock = 1000000, int32_t scratchAddress = -1);
+  uint32_t getClock();           //  0 = not calibrated
+  uint32_t getBytesPerSecond();  //  measured read throughput at getClock()
+
+
+  //  READ SHADOW
+  //  keeps a RAM copy of the bytes of the most recently written page(s).
+  //  reads that fall entirely inside them are served from RAM while the
+  //  device is still in its write cycle, other reads wait for ACK as usual.
+  //  the *Verify() functions always read the device.
+  //  buffer holds size / I2C_EEPROM_SHADOW_ENTRY(getPageSize()) pages,
+  //  enable after setPageSize().
+  bool     enableReadShadow(uint8_t * buffer, uint16_t size);
+  void     disableReadShadow();
+  void     clearReadShadow();
+  uint8_t  getShadowPages();
+  uint32_t getShadowHits();
+
+
+  //  TRACING
+  //  install a tracer to get begin / end callbacks for the public operations
+  //  and an event per bus transaction and ready wait, see I2C_eeprom_trace.h
+  //  NULL removes it, without tracer the hooks cost one pointer test.
+  void     setTracer(I2C_eeprom_tracer * tracer);
+  I2C_eeprom_tracer * getTracer();
+
+
   // ID Page specific
   // Should be obvious the this will only work if it's an STMicroelectronics "-D" device WITH Identification Page feature.
   uint8_t lockIDPage();
-  bool    isIDPageLocked();
+  //  probes the device once and caches the lock state, it only changes by
+  //  lockIDPage(). refresh = true probes again.
+  bool    isIDPageLocked(bool refresh = false);
+  uint8_t getIDPageLockState();
 
 private:
   uint8_t  _deviceAddress;
   uint8_t  _idPageDeviceAddress = 0;
+  uint8_t  _idPageLock = I2C_EEPROM_IDPAGE_UNKNOWN;
   uint32_t _lastWrite  = 0;  //  for waitEEReady
   uint32_t _deviceSize = 0;
   uint8_t  _pageSize   = 0;
@@ -181,9 +332,19 @@ private:
   int      _WriteBlock(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage = false);
   //  returns bytes read.
   uint16_t  _ReadBlock(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage = false);
+  //  returns bytes read, any length, no operation scope.
+  uint16_t _readChunked(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage = false);
   //  compare bytes in EEPROM.
   bool     _verifyBlock(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage = false);
 
+  //  address phase + requestFrom() with retries, returns bytes available.
+  uint16_t _requestBlock(const uint16_t memoryAddress, const uint16_t length, bool IDPage);
+  void     _retryWait(const int rv, const uint16_t memoryAddress, uint16_t & backoff);
+  void     _failed(const int rv, const uint16_t memoryAddress);
+
+  //  returns I2C status, 0 = OK
+  int      _copy(I2C_eeprom & target, const uint16_t src, const uint16_t dst, const uint16_t length);
+
   //  to optimize the write latency of the EEPROM
   void     _waitEEReady(bool IDPage = false);
 
@@ -196,6 +357,44 @@ private:
   bool     _perByteCompare = PER_BYTE_COMPARE;
   bool     _hasIDPage = HAS_ID_PAGE;
 
+  //  error recovery, see setRetryPolicy()
+  uint8_t  _retries    = I2C_EEPROM_RETRIES;
+  uint16_t _backoff    = I2C_EEPROM_RETRY_BACKOFF;
+  uint16_t _maxBackoff = I2C_EEPROM_RETRY_MAX_BACKOFF;
+  int8_t   _sdaPin     = -1;
+  int8_t   _sclPin     = -1;
+  uint8_t  _opDepth    = 0;
+  int      _lastError  = 0;
+  uint16_t _lastErrorAddress = 0;
+  uint8_t  _lastRetries   = 0;
+  uint32_t _retryCount    = 0;
+  uint32_t _recoveryCount = 0;
+  friend class I2C_eeprom_opScope;
+
+  uint32_t _clock = 0;
+  uint32_t _busClock = 0;         //  clock in use, restored by recoverBus()
+  uint32_t _bytesPerSecond = 0;
+  void     _setClock(const uint32_t clock);
+  bool     _probeClock(uint32_t clock, const uint8_t * reference, uint16_t length, int32_t scratchAddress);
+
+  //  wear tracking, see enableWearTracking()
+  uint16_t * _wearCounters = NULL;
+  uint16_t _wearPages    = 0;
+  uint16_t _idPageWrites = 0;
+  uint32_t _totalWrites  = 0;
+  void     _countWear(const uint16_t memoryAddress, bool IDPage);
+
+  I2C_eeprom_tracer * _tracer = NULL;
+
+  //  read shadow, see enableReadShadow()
+  uint8_t * _shadow     = NULL;
+  uint8_t  _shadowPages = 0;
+  uint8_t  _shadowNext  = 0;  //  FIFO replacement
+  uint32_t _shadowHits  = 0;
+  uint8_t * _shadowEntry(const uint16_t page, bool IDPage);
+  void     _shadowWrite(const uint16_t memoryAddress, const uint8_t * buffer, const uint16_t length, bool IDPage, int rv);
+  bool     _shadowRead(const uint16_t memoryAddress, uint8_t * buffer, const uint16_t length, bool IDPage);
+
   UNIT_TEST_FRIEND;
 };
 
@@ -0,0 +1,66 @@
+#pragma once
+//
+//    FILE: Arduino.h
+// PURPOSE: host side simulation of the Arduino core for the tests in test/
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+typedef uint8_t byte;
+typedef bool boolean;
+#define HEX 16
+#define DEC 10
+#define OUTPUT 1
+#define INPUT 0
+#define INPUT_PULLUP 2
+#define LOW 0
+#define HIGH 1
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t);
+void delayMicroseconds(uint32_t);
+void yield();
+void pinMode(int, int);
+void digitalWrite(int, int);
+int digitalRead(int);
+class __FlashStringHelper;
+#define F(x) (reinterpret_cast<const __FlashStringHelper*>(x))
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *b, size_t n) { size_t r = 0; while (n--) r += write(*b++); return r; }
+  size_t write(const char *s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long v, int base = DEC) { char b[24]; snprintf(b, sizeof b, base == HEX ? "%lx" : "%ld", v); return write(b); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned long v, int base = DEC) { return print((long)v, base); }
+  size_t print(double v, int d = 2) { char b[32]; snprintf(b, sizeof b, "%.*f", d, v); return write(b); }
+  size_t print(const __FlashStringHelper *s) { return write((const char*)s); }
+  template <typename T> size_t println(T v) { size_t r = print(v); return r + write("\n"); }
+  template <typename T> size_t println(T v, int b) { size_t r = print(v, b); return r + write("\n"); }
+  size_t println() { return write("\n"); }
+  virtual void flush() {}
+};
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  size_t readBytes(uint8_t *b, size_t n) { size_t i = 0; while (i < n) { int c = read(); if (c < 0) break; b[i++] = c; } return i; }
+};
+class SerialStub : public Stream {
+public:
+  size_t write(uint8_t c) override { fputc(c, stdout); return 1; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void begin(long) {}
+};
+extern SerialStub Serial;
@@ -0,0 +1,60 @@
+#pragma once
+//
+//    FILE: Wire.h
+// PURPOSE: host side simulation of TwoWire with M24xxx devices for the tests in test/
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+
+#include "Arduino.h"
+#include <map>
+#include <vector>
+
+//  simulated M24xxx device
+struct SimEeprom
+{
+  std::vector<uint8_t> mem;
+  std::vector<uint8_t> id;
+  uint16_t pageSize = 64;
+  bool twoByte = true;
+  bool locked = false;
+  uint32_t busyUntil = 0;
+  bool busy = false;
+  uint32_t maxClock = 400000;
+  int failNext = 0;        //  NACK next n write transactions
+  int dropNext = 0;        //  ACK but do not store next n writes
+  int failReadNext = 0;    //  no data for next n reads
+  uint32_t writeCycles = 0;
+  uint32_t readTransactions = 0;
+  uint32_t pointer = 0;
+  bool idSel = false;
+  SimEeprom(uint32_t size, uint16_t ps, bool two) : mem(size, 0xFF), id(ps, 0xFF), pageSize(ps), twoByte(two) {}
+};
+
+class TwoWire
+{
+public:
+  void begin() {}
+  void setClock(uint32_t c) { clock = c; }
+  uint32_t getClock() { return clock; }
+  void attach(uint8_t addr, SimEeprom *e, bool idpage = false) { devs[addr] = {e, idpage}; }
+  void beginTransmission(uint8_t addr) { txAddr = addr; tx.clear(); }
+  size_t write(uint8_t b) { tx.push_back(b); return 1; }
+  size_t write(const uint8_t *b, size_t n) { for (size_t i = 0; i < n; i++) tx.push_back(b[i]); return n; }
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(int addr, int len);
+  int read() { return rxPos < rx.size() ? rx[rxPos++] : -1; }
+  int available() { return rx.size() - rxPos; }
+  uint32_t clock = 100000;
+  uint32_t transactions = 0;
+  uint32_t bytesOnBus = 0;
+  uint32_t transferMicros = 0;   //  simulated time spent on the bus
+private:
+  struct Dev { SimEeprom *e; bool id; };
+  Dev *find(uint8_t addr, uint32_t &hi);
+  void spend(size_t bytes);
+  std::map<uint8_t, Dev> devs;
+  uint8_t txAddr = 0;
+  std::vector<uint8_t> tx, rx;
+  size_t rxPos = 0;
+};
+extern TwoWire Wire;
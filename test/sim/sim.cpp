@@ -0,0 +1,98 @@
+//
+//    FILE: sim.cpp
+// PURPOSE: host side simulation of TwoWire with M24xxx devices for the tests in test/
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+
+#include "Arduino.h"
+#include "Wire.h"
+#include <chrono>
+#include <thread>
+SerialStub Serial;
+TwoWire Wire;
+static auto t0 = std::chrono::steady_clock::now();
+uint32_t micros() { return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count(); }
+uint32_t millis() { return micros() / 1000; }
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void yield() { std::this_thread::yield(); }
+int pins[64];
+void pinMode(int p, int m) { if (p >= 0 && p < 64 && m == INPUT_PULLUP) pins[p] = HIGH; }
+void digitalWrite(int p, int v) { if (p < 0 || p >= 64) return; pins[p] = v; }
+int digitalRead(int p) { return pins[p]; }
+
+void TwoWire::spend(size_t bytes)
+{
+  bytesOnBus += bytes;
+  uint32_t us = (uint32_t)((bytes + 1) * 9ULL * 1000000ULL / clock);
+  transferMicros += us;
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+TwoWire::Dev *TwoWire::find(uint8_t addr, uint32_t &hi)
+{
+  for (auto &kv : devs)
+  {
+    SimEeprom *e = kv.second.e;
+    uint8_t mask = e->twoByte ? 0 : 0x07;
+    if ((addr & ~mask) == kv.first) { hi = addr & mask; return &kv.second; }
+  }
+  return nullptr;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+  transactions++;
+  spend(tx.size() + 1);
+  uint32_t hi;
+  Dev *d = find(txAddr, hi);
+  if (!d) return 2;
+  SimEeprom *e = d->e;
+  if (micros() < e->busyUntil) return 2;
+  if (tx.empty()) return 0;
+  if (clock > e->maxClock) return 4;
+  size_t hdr = e->twoByte ? 2 : 1;
+  if (tx.size() < hdr) return 0;
+  uint32_t addr = e->twoByte ? ((tx[0] << 8) | tx[1]) : ((hi << 8) | tx[0]);
+  if (tx.size() == hdr) { e->pointer = addr; e->idSel = d->id; return 0; }
+  //  a repeated START aborts the write, only the ACK of the data is seen.
+  if (!stop) return (d->id && e->locked) ? 3 : 0;
+  if (e->failNext > 0) { e->failNext--; return 3; }
+  if (d->id)
+  {
+    if (addr & 0x400) { if (e->locked) return 3; e->locked = (tx[hdr] & 0x02); e->busyUntil = micros() + 5000; return 0; }
+    if (e->locked) return 3;
+  }
+  if (e->dropNext > 0) { e->dropNext--; e->writeCycles++; e->busyUntil = micros() + 5000; return 0; }
+  std::vector<uint8_t> &m = d->id ? e->id : e->mem;
+  uint32_t base = addr & ~(uint32_t)(e->pageSize - 1);
+  uint32_t off = addr - base;
+  for (size_t i = hdr; i < tx.size(); i++)
+  {
+    m[(base + off) % m.size()] = tx[i];
+    off = (off + 1) % e->pageSize;
+  }
+  e->writeCycles++;
+  e->busyUntil = micros() + 5000;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(int addr, int len)
+{
+  transactions++;
+  rx.clear(); rxPos = 0;
+  uint32_t hi;
+  Dev *d = find(addr, hi);
+  if (!d) return 0;
+  SimEeprom *e = d->e;
+  if (micros() < e->busyUntil) return 0;
+  if (e->failReadNext > 0) { e->failReadNext--; return 0; }
+  e->readTransactions++;
+  std::vector<uint8_t> &m = d->id ? e->id : e->mem;
+  uint32_t p = e->twoByte ? e->pointer : ((hi << 8) | (e->pointer & 0xFF));
+  for (int i = 0; i < len; i++) rx.push_back(m[(p + i) % m.size()]);
+  if (clock > e->maxClock && len > 0) rx[0] ^= 0x01;
+  e->pointer = p + len;
+  spend(len + 1);
+  return len;
+}
@@ -0,0 +1,86 @@
+//
+//    FILE: test_multibus.cpp
+// PURPOSE: I2C_eeprom_multibus against 1..3 simulated buses, checks data and scaling
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+//
+//  build with -D I2C_EEPROM_USE_STD_THREAD=1 for one std::thread per bus,
+//  reads only scale with threads, writes scale in both modes.
+
+
+#include "I2C_eeprom_multibus.h"
+#include <assert.h>
+
+
+#define BUSES     3
+#define LENGTH    2048
+
+
+TwoWire    wires[BUSES];
+SimEeprom  * sims[BUSES];
+I2C_eeprom * eeproms[BUSES];
+uint8_t    data[BUSES][LENGTH];
+uint8_t    back[BUSES][LENGTH];
+
+
+//  returns aggregate bytes per second of the engine over the first n buses.
+uint32_t run(const uint8_t n, const bool write, const uint8_t pattern)
+{
+  I2C_eeprom_multibus engine;
+  for (uint8_t b = 0; b < n; b++)
+  {
+    for (uint16_t i = 0; i < LENGTH; i++) data[b][i] = i * (b + 3) + pattern;
+    memset(back[b], 0, LENGTH);
+    if (write) assert(engine.addWrite(*eeproms[b], 100, data[b], LENGTH) == b);
+    else       assert(engine.addRead(*eeproms[b], 100, back[b], LENGTH) == b);
+  }
+  assert(engine.buses() == n);
+  assert(engine.run() == 0);
+  assert(engine.getBytes() == (uint32_t)n * LENGTH);
+  for (uint8_t b = 0; b < n; b++) assert(engine.isDone(b));
+  return engine.getBytesPerSecond();
+}
+
+
+int main()
+{
+  for (uint8_t b = 0; b < BUSES; b++)
+  {
+    sims[b] = new SimEeprom(32768, 64, true);
+    wires[b].attach(0x50, sims[b]);
+    wires[b].setClock(400000);
+    eeproms[b] = new I2C_eeprom(0x50, I2C_DEVICESIZE_M24256, false, &wires[b]);
+    assert(eeproms[b]->begin());
+  }
+
+  printf("threads: %d\n", I2C_EEPROM_USE_STD_THREAD);
+  uint32_t write1 = 0, read1 = 0;
+  for (uint8_t n = 1; n <= BUSES; n++)
+  {
+    uint32_t w = run(n, true, n);
+    uint32_t r = run(n, false, n);
+    for (uint8_t b = 0; b < n; b++)
+    {
+      for (uint16_t i = 0; i < LENGTH; i++) data[b][i] = i * (b + 3) + n;
+      assert(memcmp(data[b], back[b], LENGTH) == 0);
+    }
+    if (n == 1)
+    {
+      write1 = w;
+      read1  = r;
+    }
+    printf("buses %d  write %6u B/s (x%.2f)  read %6u B/s (x%.2f)\n", n, w, (double) w / write1, r, (double) r / read1);
+    if (n == BUSES)
+    {
+      //  near linear, with margin for the host scheduler.
+      assert(w > write1 * BUSES * 7 / 10);
+#if I2C_EEPROM_USE_STD_THREAD
+      assert(r > read1 * BUSES * 6 / 10);
+#endif
+    }
+  }
+  printf("ok\n");
+  return 0;
+}
+
+
+//  -- END OF FILE --
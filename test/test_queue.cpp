@@ -0,0 +1,119 @@
+//
+//    FILE: test_queue.cpp
+// PURPOSE: I2C_eeprom_queue, page merging and a producer thread against a draining consumer
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_queue.h"
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+#include <atomic>
+
+
+#define SLOTS     16
+#define RECORDS   2000
+//  a drain of the SLOTS page takes 3 write cycles (30 byte chunks) of 5 ms,
+//  a full ring of 128 records at this pace lasts longer than that.
+#define PACE      500     //  microseconds between pushes
+
+
+int main()
+{
+  SimEeprom sim(32768, 64, true);
+  Wire.attach(0x50, &sim);
+  I2C_eeprom ee(0x50, I2C_DEVICESIZE_M24256, false);
+  assert(ee.begin());
+
+  //  merge, newest wins, one writeBlock() per page.
+  static I2C_eeprom_queue<16, 4> q;
+  uint8_t a[4] = { 1, 2, 3, 4 };
+  uint8_t b[4] = { 9, 9, 9, 9 };
+  sim.mem[12] = 0x55;                //  gap, must survive
+  assert(q.push(60, a, 4));          //  page 0
+  assert(q.push(62, b, 4));          //  page 0 and 1
+  assert(q.push(10, a, 2));          //  page 0
+  assert(! q.push(0, a, 5));         //  too long
+  assert(q.drain(ee) == 0);
+  assert(q.isEmpty());
+  assert(q.getPageWrites() == 2);
+  assert(sim.mem[10] == 1 && sim.mem[11] == 2 && sim.mem[12] == 0x55);
+  assert(sim.mem[60] == 1 && sim.mem[61] == 2 && sim.mem[62] == 9 && sim.mem[65] == 9);
+  assert(q.getOverflows() == 1);
+
+  //  sixteen records spread over one page.
+  uint32_t writes = q.getPageWrites();
+  for (uint8_t i = 0; i < 16; i++)
+  {
+    uint8_t v = 100 + i;
+    assert(q.push(128 + i * 4, &v, 1));
+  }
+  assert(q.drain(ee) == 0);
+  assert(q.getPageWrites() - writes == 1);
+  for (uint8_t i = 0; i < 16; i++) assert(sim.mem[128 + i * 4] == 100 + i);
+  assert(sim.mem[129] == 0xFF);
+
+  //  a failed write keeps the records queued.
+  delay(10);
+  assert(q.push(200, a, 1));
+  sim.failNext = 1;
+  assert(q.drain(ee) != 0);
+  assert(q.count() == 1);
+  assert(q.drain(ee) == 0);
+  assert(sim.mem[200] == 1);
+
+  //  a failed gap read too.
+  delay(10);
+  assert(q.push(300, a, 1));
+  assert(q.push(310, b, 1));
+  sim.failReadNext = 1;
+  assert(q.drain(ee) == 14);
+  assert(q.count() == 2);
+  assert(q.drain(ee) == 0);
+  assert(sim.mem[300] == 1 && sim.mem[310] == 9);
+
+  //  stress, a paced producer thread pushes counters into SLOTS slots
+  //  while the foreground drains.
+  static I2C_eeprom_queue<128, 4> s;
+  static uint32_t lastPushed[SLOTS];
+  uint32_t pushed = 0;
+  std::atomic<bool> done(false);
+  std::thread producer([&]
+  {
+    for (uint32_t i = 1; i <= RECORDS; i++)
+    {
+      if (s.push(1024 + (i % SLOTS) * 4, &i, 4))
+      {
+        pushed++;
+        lastPushed[i % SLOTS] = i;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(PACE));
+    }
+    done = true;
+  });
+  while (! done || ! s.isEmpty())
+  {
+    assert(s.drain(ee) == 0);
+  }
+  producer.join();
+  assert(s.drain(ee) == 0);
+
+  printf("pushed %u  overflows %u  drained %u  page writes %u\n",
+         pushed, s.getOverflows(), s.getDrained(), s.getPageWrites());
+  assert(pushed + s.getOverflows() == RECORDS);
+  //  most records are delivered, push and drain overlap.
+  assert(s.getOverflows() < RECORDS / 10);
+  assert(s.getDrained() == pushed);
+  //  every slot holds the last value pushed for it.
+  for (uint8_t k = 0; k < SLOTS; k++)
+  {
+    uint32_t v;
+    memcpy(&v, &sim.mem[1024 + k * 4], 4);
+    assert(v == lastPushed[k]);
+  }
+  printf("ok\n");
+  return 0;
+}
+
+
+//  -- END OF FILE --
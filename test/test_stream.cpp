@@ -0,0 +1,65 @@
+//
+//    FILE: test_stream.cpp
+// PURPOSE: I2C_eeprom_stream, write combining mixed with read ahead
+//     URL: https://github.com/RobTillaart/I2C_EEPROM.git
+
+
+#include "I2C_eeprom_stream.h"
+#include <assert.h>
+
+
+int main()
+{
+  SimEeprom sim(32768, 64, true);
+  Wire.attach(0x50, &sim);
+  I2C_eeprom ee(0x50, I2C_DEVICESIZE_M24256, false);
+  assert(ee.begin());
+  memcpy(&sim.mem[1000], "zxyw", 4);
+
+  //  write, read ahead hit, write.
+  I2C_eeprom_stream s(ee, 1000, 100);
+  assert(s.read() == 'z');           //  fills the read ahead
+  assert(s.seek(0));
+  assert(s.write('A') == 1);
+  assert(s.read() == 'x');           //  hit, position 2, 'A' still pending
+  assert(s.write('C') == 1);
+  s.flush();
+  assert(memcmp(&sim.mem[1000], "AxCw", 4) == 0);
+  assert(s.getError() == 0);
+
+  //  pending writes are visible to reads in and outside the read ahead.
+  assert(s.seek(10));
+  s.print("hello");
+  assert(s.seek(10));
+  assert(s.read() == 'h');
+  assert(s.read() == 'e');
+  s.write('L');
+  assert(s.read() == 'l');
+  assert(s.read() == 'o');
+  s.flush();
+  assert(memcmp(&sim.mem[1010], "heLlo", 5) == 0);
+
+  //  page sized combining: 64 bytes in one page, one write transaction per chunk.
+  assert(s.seek(24));                //  address 1024, page aligned
+  uint32_t cycles = sim.writeCycles;
+  for (int i = 0; i < 64; i++) s.write('a' + i % 26);
+  s.flush();
+  printf("cycles for one page: %u\n", sim.writeCycles - cycles);
+  //  writeBlock() splits the page in 30 byte I2C_BUFFERSIZE chunks on the host.
+  assert(sim.writeCycles - cycles == 3);
+  assert(sim.mem[1024] == 'a' && sim.mem[1087] == 'a' + 63 % 26);
+
+  //  pending bytes are flushed when the stream goes out of scope.
+  {
+    I2C_eeprom_stream t(ee, 2000, 10);
+    t.print("bye");
+    assert(memcmp(&sim.mem[2000], "bye", 3) != 0);
+  }
+  assert(memcmp(&sim.mem[2000], "bye", 3) == 0);
+
+  printf("ok\n");
+  return 0;
+}
+
+
+//  -- END OF FILE --